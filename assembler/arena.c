@@ -0,0 +1,161 @@
+/* This file is implementing the arena allocator.
+ * All the memory of an assembled file is allocated from a single arena,
+ * and freed at once when the file is done. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+
+/* Every allocation is aligned to the strictest alignment of these types */
+typedef union alignment {
+    long l;
+    double d;
+    void *p;
+} Alignment;
+
+#define ALIGN(size) (((size) + sizeof(Alignment) - 1) / sizeof(Alignment) * sizeof(Alignment))
+#define BLOCK_HEADER ALIGN(sizeof(ArenaBlock))
+#define BLOCK_DATA(block) ((char *) (block) + BLOCK_HEADER)
+
+
+static bptr new_block(aptr arena, size_t size);
+
+static int allocate_error(char *func);
+
+
+/* Create a new empty arena */
+aptr new_arena() {
+    aptr arena;
+
+    if (!(arena = try_new_arena()))
+        exit(allocate_error("new_arena"));
+
+    return arena;
+}
+
+
+/* Create a new empty arena like 'new_arena', but returns NULL instead of exiting if there's no memory */
+aptr try_new_arena() {
+    aptr arena;
+
+    if (!(arena = (aptr) malloc(sizeof(Arena))))
+        return NULL;
+
+    arena->blocks = NULL;
+    arena->last = NULL;
+    arena->allocations = 0;
+    arena->allocated = 0;
+    arena->failure = NULL;
+
+    return arena;
+}
+
+
+/* Allocates 'size' bytes from the arena */
+void *arena_alloc(aptr arena, size_t size) {
+    bptr block = arena->blocks;
+
+    size = ALIGN(size);
+    arena->allocations++;
+    arena->allocated += size;
+
+    if (!block || block->size - block->used < size) {
+        if (size > ARENA_BLOCK_SIZE / 4 && block) {
+            /* a large allocation gets a block of its own, behind the current block */
+            bptr large = new_block(arena, size);
+            large->used = size;
+            large->next = block->next;
+            block->next = large;
+            return BLOCK_DATA(large);
+        }
+        block = new_block(arena, size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        block->next = arena->blocks;
+        arena->blocks = block;
+    }
+
+    arena->last = BLOCK_DATA(block) + block->used;
+    block->used += size;
+
+    return arena->last;
+}
+
+
+/* Allocates 'size' zeroed bytes from the arena */
+void *arena_calloc(aptr arena, size_t size) {
+    return memset(arena_alloc(arena, size), 0, size);
+}
+
+
+/* Grows an allocation from 'old_size' to 'new_size' bytes, keeping its content */
+void *arena_grow(aptr arena, void *old, size_t old_size, size_t new_size) {
+    bptr block = arena->blocks;
+    void *new;
+
+    if (old && old == arena->last) {
+        size_t offset = (size_t) ((char *) old - BLOCK_DATA(block));
+        if (block->size - offset >= ALIGN(new_size)) {
+            arena->allocated += offset + ALIGN(new_size) - block->used;
+            block->used = offset + ALIGN(new_size);
+            return old;
+        }
+    }
+
+    new = arena_alloc(arena, new_size);
+    if (old)
+        memcpy(new, old, old_size);
+
+    return new;
+}
+
+
+/* Copies 'length' characters of a string into the arena, and terminates the copy */
+char *arena_strndup(aptr arena, const char *str, size_t length) {
+    char *copy = (char *) arena_alloc(arena, length + 1);
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+
+/* Frees the arena and everything that was allocated from it */
+void delete_arena(aptr arena) {
+    bptr temp;
+
+    if (arena) {
+        while (arena->blocks) {
+            temp = arena->blocks;
+            arena->blocks = temp->next;
+            free(temp);
+        }
+        free(arena);
+    }
+}
+
+
+/* Allocates a new block with 'size' usable bytes */
+static bptr new_block(aptr arena, size_t size) {
+    bptr block;
+
+    if (!(block = (bptr) malloc(BLOCK_HEADER + size))) {
+        if (arena->failure)
+            longjmp(*arena->failure, 1);
+        exit(allocate_error("arena_alloc"));
+    }
+
+    block->next = NULL;
+    block->size = size;
+    block->used = 0;
+
+    return block;
+}
+
+
+/* Memory allocation fail */
+static int allocate_error(char *func) {
+    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
+    return 1;
+}
@@ -0,0 +1,58 @@
+#ifndef PROJECT_ARENA_H
+#define PROJECT_ARENA_H
+
+#include <stddef.h>
+#include <setjmp.h>
+
+#define ARENA_BLOCK_SIZE 65536      /* Default size of an arena block in bytes */
+
+
+/* A block of memory owned by an arena - used as a linked list */
+typedef struct arena_block *bptr;
+typedef struct arena_block {
+    bptr next;
+    size_t size;                    /* Number of usable bytes in the block */
+    size_t used;                    /* Number of bytes handed out from the block */
+} ArenaBlock;
+
+
+/* Arena - hands out memory by bump allocation and frees all of it at once */
+typedef struct arena *aptr;
+typedef struct arena {
+    bptr blocks;                    /* The current block is the head of the list */
+    void *last;                     /* The last allocation, it can be grown in place */
+    unsigned long allocations;      /* Number of allocations, for the statistics */
+    size_t allocated;               /* Number of bytes allocated, for the statistics */
+    jmp_buf *failure;               /* A failed allocation jumps here, or exits the program if it's NULL */
+} Arena;
+
+
+/* Create a new empty arena */
+aptr new_arena();
+
+
+/* Create a new empty arena like 'new_arena', but returns NULL instead of exiting if there's no memory */
+aptr try_new_arena();
+
+
+/* Allocates 'size' bytes from the arena */
+void *arena_alloc(aptr arena, size_t size);
+
+
+/* Allocates 'size' zeroed bytes from the arena */
+void *arena_calloc(aptr arena, size_t size);
+
+
+/* Grows an allocation from 'old_size' to 'new_size' bytes, keeping its content */
+void *arena_grow(aptr arena, void *old, size_t old_size, size_t new_size);
+
+
+/* Copies 'length' characters of a string into the arena, and terminates the copy */
+char *arena_strndup(aptr arena, const char *str, size_t length);
+
+
+/* Frees the arena and everything that was allocated from it */
+void delete_arena(aptr arena);
+
+
+#endif
@@ -6,443 +6,597 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <math.h>
+#include <stdarg.h>
 #include "assemble.h"
 #include "memory.h"
+#include "source.h"
+#include "macros.h"
+#include "chunks.h"
+#include "output.h"
+#include "library.h"
+#include "object.h"
 
 
-#define MAX_ERROR_LENGTH 100
-#define BIN 2
-#define HALF 6
 #define EXT_LENGTH 3
+#define OPTIONS_KEY_LENGTH 64
 
 
 enum {
     FALSE, TRUE
 };
 
-enum {
-    LOWER, UPPER
-};
 
+static int first_pass(asmptr job, srcptr source);
+
+static int chunked_passes(asmptr job, srcptr source);
+
+static int second_pass(asmptr job, stlptr statements, tptr symbols_table, segptr data_memory,
+                       segptr instruction_memory, aptr arena);
+
+static int write_outputs(asmptr job, tptr symbols_table, segptr data_memory, segptr instruction_memory,
+                         aptr arena);
+
+static void first_pass_statement(asmptr job, stmtptr statement, stlptr statements, tptr symbols_table,
+                                 segptr data_memory, segptr instruction, fxptr fixups,
+                                 unsigned int *instruction_counter);
+
+static void define_symbol(asmptr job, tptr symbols_table, char *name, unsigned int value, SymbolType type,
+                          unsigned int line, unsigned int column);
 
-static int first_pass(char *file_name, unsigned int address);
+static int restore_outputs(asmptr job, srcptr source);
 
-static int second_pass(char *file_name, unsigned int address, sptr symbols_table, wptr data_memory);
+static void create_ent(asmptr job, tptr symbols_table, bufptr buffer);
 
-static void create_ent(char *file_name, sptr symbols_table);
+static void create_ext(asmptr job, segptr instruction_memory, bufptr buffer);
 
-static void create_ext(char *file_name, wptr instruction_memory);
+static void create_ob(asmptr job, segptr data_memory, segptr instruction_memory, bufptr buffer);
 
-static void create_ob(char *file_name, wptr data_memory, wptr instruction_memory);
+static void create_bo(asmptr job, tptr symbols_table, segptr data_memory, segptr instruction_memory, bufptr buffer);
 
-static char *create_file_name(char *file_name, char *format);
+static void create_file(asmptr job, bufptr buffer, char *extension);
+
+static void collect_stats(asmptr job, aptr arena, tptr symbols_table, segptr data_memory, segptr instruction_memory);
+
+static char *create_file_name(asmptr job, char *extension);
+
+static void append_relative_path(char *directory, char *path, size_t length);
 
 static char *get_file_name(char *file_name);
 
-static int convert_binary_to_decimal(const short *word, int part);
+static void syntax_error(asmptr job, unsigned int line, unsigned int column, ErrorCode code);
 
-static void syntax_error(unsigned int line, char *str);
+static void print_message(asmptr job, const char *format, ...);
 
-static int openfile_error(char *file_name);
+static void print_warning(asmptr job, const char *message);
 
-static char *skip_spaces(char *address);
+static int openfile_error(asmptr job, char *file_name);
 
 static int allocate_error(char *func);
 
 
-int main(int argc, char *argv[]) {
-    int i, run = 0;
+/* Set the default options of the assembler */
+void default_options(optptr options) {
+    options->address = DEFAULT_ADDRESS;
+    options->max_errors = 0;
+    options->max_line_length = 0;
+    options->error_format = TEXT_FORMAT;
+    options->jobs = 0;
+    options->one_pass = FALSE;
+    options->stats = FALSE;
+    options->stats_format = TEXT_FORMAT;
+    options->cache_directory = NULL;
+    options->cache_size = DEFAULT_CACHE_SIZE;
+    options->server = NULL;
+    options->output_directory = NULL;
+    options->binary = FALSE;
+    options->threads = 0;
+}
 
-    if (!argc) {
-        printf("No input files detected. \n");
-        return 1;
-    }
 
-    for (i = 1; i < argc; i++) {
-        if (assemble(argv[i], DEFAULT_ADDRESS))
-            run++;
-        printf("\n\n");
+/* Launching the assembler by calling 'first_pass' */
+int assemble(char *file_name, unsigned int address) {
+    Options options;
+
+    default_options(&options);
+    options.address = address;
+
+    return assemble_to(file_name, &options, stdout);
+}
+
+
+/* Launching the assembler with the given options, the messages of the job are printed to 'out' */
+int assemble_to(char *file_name, optptr options, FILE *out) {
+    return assemble_file(file_name, options, out, NULL);
+}
+
+
+/* Launching the assembler like 'assemble_to', and adding the statistics of the job to 'stats' unless it's NULL */
+int assemble_file(char *file_name, optptr options, FILE *out, statptr stats) {
+    int run;
+    Assembly job;
+    srcptr source;
+
+    job.file_name = get_file_name(file_name);
+    job.address = options->address;
+    job.options = options;
+    job.out = out;
+    job.stats = stats;
+    job.arena = new_arena();        /* owns all the memory of the file until the end of the second pass */
+    job.result = NULL;
+    init_diagnostics(&job.diagnostics, options->max_errors, job.arena);
+    init_buffer(&job.warnings, job.arena);
+
+    if (!(source = read_source(job.file_name, job.arena)))
+        run = openfile_error(&job, job.file_name);
+    else {
+        print_message(&job, "Assembling: '%s' \n", job.file_name);
+        if (options->cache_directory && restore_outputs(&job, source))
+            run = TRUE;
+        else
+            run = assemble_source(&job, source);
     }
 
-    printf("Successfully assembled %d files out of %d.\n", run, argc - 1);
+    delete_arena(job.arena);
+    free(job.file_name);
 
-    return 0;
+    return run;
 }
 
 
-/* Launching the assembler by calling 'first_pass' */
-int assemble(char *file_name, unsigned int address) {
+/* Assembles a source of a job whose fields are all set. Returns 1 on success, else returns 0 */
+int assemble_source(asmptr job, srcptr source) {
+    source = expand_macros(source, &job->diagnostics);
+
+    if (job->options->threads > 1 && !job->options->one_pass && !job->diagnostics.count)
+        return chunked_passes(job, source);
+    return first_pass(job, source);
+}
+
+
+/* Assembles a large source in chunks on 'threads' threads, with the outputs of the serial passes.
+ * A source which is too small to be split, or which has errors or warnings, is assembled by the serial passes */
+static int chunked_passes(asmptr job, srcptr source) {
+    Chunks chunks;
+    tptr symbols_table;
+    segptr data_memory, instruction_memory;
+    double start;
     int run;
-    char *name = get_file_name(file_name);
 
-    run = first_pass(name, address);
+    if (!split_source(&chunks, source, job->options->threads, job->address, job->arena))
+        return first_pass(job, source);
+
+    start = start_phase(job->stats);
+    data_memory = new_segment(job->address, job->arena);
+    if (!size_chunks(&chunks, job->options->max_line_length, job->arena) ||
+        !(symbols_table = merge_chunks(&chunks, data_memory, job->arena))) {
+        restore_source(&chunks);
+        delete_chunks(&chunks);
+        return first_pass(job, source);
+    }
+    end_phase(job->stats, FIRST_PASS_PHASE, start);
+    if (job->stats)
+        job->stats->lines += chunks.lines;
+    print_message(job, "First pass: Done. \n");
+
+    start = start_phase(job->stats);
+    symbols_table->counting = (job->stats != NULL);       /* the chunks count their lookups on copies of the table */
+    instruction_memory = encode_chunks(&chunks, symbols_table, job->arena);
+    end_phase(job->stats, SECOND_PASS_PHASE, start);
+
+    run = write_outputs(job, symbols_table, data_memory, instruction_memory, job->arena);
+    delete_chunks(&chunks);
+    if (job->stats) {
+        job->stats->allocations += chunks.allocations;
+        job->stats->allocated += chunks.allocated;
+    }
 
     return run;
 }
 
 
-/* Creating the data memory and the symbols table, and counting the instructions with 'instruction_counter' for the second pass */
-static int first_pass(char *file_name, unsigned int address) {
-    FILE *fd;
-    char buf[MAX_LINE_LENGTH], *temp = NULL;
-    unsigned int line, data_counter, instruction_counter;
-    int label_flag, error_flag;
-    wptr data, data_memory, instruction;
-    sptr symbol, symbols_table;
-    StatementType type;
-
-    if (!(fd = fopen(file_name, "r")))
-        return openfile_error(file_name);
-
-    printf("Assembling: '%s' \n", file_name);
-
-    line = data_counter = instruction_counter = 0;
-    data_memory = NULL;
-    symbols_table = NULL;
-    while (fgets(buf, MAX_LINE_LENGTH, fd)) {
-
-        type = get_statement_type(buf);
-        label_flag = is_label(buf);
-        line++;
-
-        if (is_data_statement(type)) {
-            data_counter += address;
-            data = store_data(buf, &data_counter);
-            data_counter -= address;
-            if (data) {
-                data_memory = add_word(data_memory, data);
-                if (label_flag) {
-                    symbol = new_symbol(get_label_name(buf), data->address, DATA_SYMBOL);
-                    symbols_table = add_symbol(symbols_table, symbol);
-                    if (!symbols_table)
-                        syntax_error(line, "invalid label name.");
-                }
-            } else
-                syntax_error(line, "invalid data.");
-        } else if (type == EXTERN || type == ENTRY) {
-            if (type == EXTERN) {
-                temp = get_label_operand(buf, type);
-                symbol = new_symbol(temp, 0, EXTERN_SYMBOL);
-                symbols_table = add_symbol(symbols_table, symbol);
-                if (!symbols_table)
-                    syntax_error(line, "invalid label name.");
-            }
-        } else if (is_operation(buf)) {
-            instruction_counter += address;
-            instruction = store_instruction(buf, &instruction_counter,
-                                            NULL);   /* passing NULL since the symbols table isn't full yet. */
-            instruction_counter -= address;
-            if (instruction) {
-                if (label_flag) {
-                    symbol = new_symbol(get_label_name(buf), instruction->address, CODE_SYMBOL);
-                    symbols_table = add_symbol(symbols_table, symbol);
-                    if (!symbols_table)
-                        syntax_error(line, "invalid label name.");
-                }
-            }
-            delete_memory(instruction);
-        } else if (!is_comment(buf) && !is_empty(buf))
-            syntax_error(line, "invalid statement.");
+/* Creating the data memory and the symbols table, and counting the instructions with 'instruction_counter' for the second pass.
+ * In single pass mode the instructions are stored right away, and the labels which aren't final are patched at the end */
+static int first_pass(asmptr job, srcptr source) {
+    char *buf;
+    unsigned int line, origin, line_length, instruction_counter;
+    int error_flag;
+    double start;
+    ErrorCode error;
+    Statement statement;
+    stlptr statements;
+    segptr data_memory, instruction;
+    fxptr fixups;
+    tptr symbols_table;
+    aptr arena = job->arena;
+
+    start = start_phase(job->stats);
+    line = instruction_counter = 0;
+    statements = new_statements(arena);                  /* the statements which are needed by the second pass */
+    data_memory = new_segment(job->address, arena);
+    instruction = NULL;              /* the instructions are stored on the first pass only in single pass mode */
+    fixups = NULL;
+    if (job->options->one_pass) {
+        instruction = new_segment(job->address, arena);
+        fixups = new_fixups(arena);
+    }
+    symbols_table = new_symbols_table(arena);
+    symbols_table->counting = (job->stats != NULL);
+    while (!too_many_errors(&job->diagnostics) && (buf = next_line(source, &line_length))) {
+        origin = get_origin(source, ++line);         /* errors are reported at the line in the file */
+        if (job->options->max_line_length && line_length > job->options->max_line_length) {
+            syntax_error(job, origin, job->options->max_line_length + 1, LINE_TOO_LONG);
+            continue;
+        }
+
+        if ((error = lex_statement(buf, origin, &statement)))
+            syntax_error(job, origin, statement.column, error);
+        else
+            first_pass_statement(job, &statement, statements, symbols_table, data_memory, instruction, fixups,
+                                 &instruction_counter);
     }
 
     update_symbols(symbols_table, &instruction_counter);
+    if (fixups)
+        resolve_fixups(fixups, instruction, symbols_table);       /* the data symbols were just moved after the code */
 
-    printf("First pass: Done. \n");
-    error_flag = get_errors();
+    end_phase(job->stats, FIRST_PASS_PHASE, start);
+    if (job->stats)
+        job->stats->lines += line;
 
-    fclose(fd);
+    print_message(job, fixups ? "Single pass: Done. \n" : "First pass: Done. \n");
+    error_flag = get_errors(job);
 
     if (error_flag) {
-        delete_symbols_table(symbols_table);
-        delete_memory(data_memory);
+        collect_stats(job, arena, symbols_table, data_memory, instruction);
         return 0;
     }
-    return second_pass(file_name, address, symbols_table, data_memory);
+    return second_pass(job, statements, symbols_table, data_memory, fixups ? instruction : NULL, arena);
 }
 
 
-/* Creating the instruction memory, and fixing missing details on the symbols table */
-static int second_pass(char *file_name, unsigned int address, sptr symbols_table, wptr data_memory) {
-    FILE *fd;
-    char buf[MAX_LINE_LENGTH], *temp;
-    unsigned int line, instruction_counter;
-    wptr instruction, instruction_memory;
-    StatementType type;
-    int error_flag;
+/* Used by 'first_pass' to store the data and the symbols of a statement, the operations and the entries are kept for the second pass.
+ * In single pass mode the operations are stored in 'instruction' instead */
+static void first_pass_statement(asmptr job, stmtptr statement, stlptr statements, tptr symbols_table,
+                                 segptr data_memory, segptr instruction, fxptr fixups,
+                                 unsigned int *instruction_counter) {
+    char *label = NULL;
+    int length;
+
+    if (statement->label.length)
+        label = arena_strndup(symbols_table->arena, statement->label.start, statement->label.length);
+
+    if (statement->kind == OPERATION_STATEMENT) {
+        if (label)
+            define_symbol(job, symbols_table, label, job->address + *instruction_counter, CODE_SYMBOL,
+                          statement->line, statement->column);
+        if (fixups)
+            length = store_instruction(statement, instruction, symbols_table, fixups);
+        else {
+            length = get_instruction_length(statement);     /* the instruction is stored on the second pass */
+            add_statement(statements, statement);
+        }
+        *instruction_counter += length;
+
+    } else if (is_data_statement(statement->directive)) {
+        unsigned int data_address = data_memory->base + data_memory->length;
+        if (store_data(statement, data_memory)) {
+            if (label)
+                define_symbol(job, symbols_table, label, data_address, DATA_SYMBOL, statement->line,
+                              statement->column);
+        } else
+            syntax_error(job, statement->line, statement->column, INVALID_DATA);
+
+    } else if (statement->directive == EXTERN) {
+        if (label)
+            print_warning(job, "WARNING: label on 'ENTRY' or 'EXTERN' statement has no effect.\n");
+        define_symbol(job, symbols_table,
+                      arena_strndup(symbols_table->arena, statement->dst.text.start, statement->dst.text.length), 0,
+                      EXTERN_SYMBOL, statement->line, statement->column);
+
+    } else if (statement->directive == ENTRY)
+        add_statement(statements, statement);
+}
 
-    line = instruction_counter = 0;
-    instruction_memory = NULL;
-
-    if (!(fd = fopen(file_name, "r")))
-        return openfile_error(file_name);
-
-    while (fgets(buf, MAX_LINE_LENGTH, fd)) {
-        type = get_statement_type(buf);
-        line++;
-
-        if (!is_data_statement(type)) {
-            if (type == ENTRY || type == EXTERN) {
-                if (type == ENTRY) {
-                    temp = get_label_operand(buf, type);
-                    set_entry(symbols_table, temp);
-                    free(temp);
-                }
-            } else if (is_operation(buf)) {
-                instruction_counter += address;
-                instruction = store_instruction(buf, &instruction_counter,
-                                                symbols_table);                 /* Passing the symbol table which was built on first pass */
-                instruction_counter -= address;
-                if (instruction)
-                    instruction_memory = add_word(instruction_memory, instruction);
-                else
-                    syntax_error(line, "invalid statement.");
-            } else if (!is_comment(buf) && !is_empty(buf))
-                syntax_error(line, "invalid statement.");
+
+/* Creating the instruction memory, and fixing missing details on the symbols table.
+ * 'instruction_memory' is the memory stored by a single pass, or NULL */
+static int second_pass(asmptr job, stlptr statements, tptr symbols_table, segptr data_memory,
+                       segptr instruction_memory, aptr arena) {
+    Statement *statement, *end = statements->list + statements->count;
+    double start = start_phase(job->stats);
+
+    if (!instruction_memory)
+        instruction_memory = new_segment(job->address, arena);
+    for (statement = statements->list; statement < end; statement++) {     /* the statements kept on first pass */
+        if (statement->kind == OPERATION_STATEMENT)
+            store_instruction(statement, instruction_memory, symbols_table,
+                              NULL);                 /* Passing the symbol table which was built on first pass */
+        else {
+            if (statement->label.length)
+                print_warning(job, "WARNING: label on 'ENTRY' or 'EXTERN' statement has no effect.\n");
+            set_entry(symbols_table, statement->dst.text.start, statement->dst.text.length);
         }
     }
 
-    error_flag = get_errors();
-    if (!error_flag)
-        printf("Second pass: Done. \n");
+    end_phase(job->stats, SECOND_PASS_PHASE, start);
 
-    create_ent(file_name, symbols_table);
-    create_ext(file_name, instruction_memory);
-    create_ob(file_name, data_memory, instruction_memory);
+    return write_outputs(job, symbols_table, data_memory, instruction_memory, arena);
+}
 
-    delete_symbols_table(symbols_table);
-    delete_memory(instruction_memory);
-    delete_memory(data_memory);
 
-    fclose(fd);
+/* Prints the errors of the second pass, and writes the output files of the job or returns its outputs to the library.
+ * Returns 1 on success, else returns 0 */
+static int write_outputs(asmptr job, tptr symbols_table, segptr data_memory, segptr instruction_memory,
+                         aptr arena) {
+    Buffer files[TOTAL_CACHED_FILES];
+    double start;
+    int error_flag;
 
-    return !error_flag;
-}
+    error_flag = get_errors(job);
+    if (!error_flag && !job->options->one_pass)
+        print_message(job, "Second pass: Done. \n");
 
+    if (job->result) {              /* assembled in memory by the library */
+        collect_result(job->result, symbols_table, data_memory, instruction_memory);
+        collect_stats(job, arena, symbols_table, data_memory, instruction_memory);
+        return !error_flag;
+    }
 
-/* Check if a line is empty */
-int is_empty(const char *instruction) {
-    int i;
+    start = start_phase(job->stats);
+    init_buffer(&files[ENT_FILE], arena);
+    create_ent(job, symbols_table, &files[ENT_FILE]);
+    end_phase(job->stats, ENT_PHASE, start);
 
-    for (i = 0; instruction[i] != '\0'; i++) {
-        if (!isspace(instruction[i]))
-            return FALSE;
-    }
+    start = start_phase(job->stats);
+    init_buffer(&files[EXT_FILE], arena);
+    create_ext(job, instruction_memory, &files[EXT_FILE]);
+    end_phase(job->stats, EXT_PHASE, start);
+
+    start = start_phase(job->stats);
+    init_buffer(&files[OB_FILE], arena);
+    create_ob(job, data_memory, instruction_memory, &files[OB_FILE]);
+    init_buffer(&files[BO_FILE], arena);
+    if (job->options->binary)
+        create_bo(job, symbols_table, data_memory, instruction_memory, &files[BO_FILE]);
+    end_phase(job->stats, OB_PHASE, start);
+    files[WARNINGS_FILE] = job->warnings;
+
+    if (job->options->cache_directory && !error_flag)
+        write_cache(job->options->cache_directory, &job->cache_key, files);
+
+    collect_stats(job, arena, symbols_table, data_memory, instruction_memory);
 
-    return TRUE;
+    return !error_flag;
 }
 
 
-/* Check if a line is a comment */
-int is_comment(char *statement) {
-    statement = skip_spaces(statement);
-    return (*statement == ';');
+/* Print the syntax errors found since the last call. Returns the number of errors printed */
+int get_errors(asmptr job) {
+    return print_diagnostics(&job->diagnostics, job->out, job->file_name, job->options->error_format);
 }
 
 
-/* Print syntax errors */
-int get_errors() {
-    FILE *err;
-    char buf[MAX_ERROR_LENGTH];
-    int count_errors = 0;
+/* Adds a label to the symbols table, or reports why it can't be added */
+static void define_symbol(asmptr job, tptr symbols_table, char *name, unsigned int value, SymbolType type,
+                          unsigned int line, unsigned int column) {
+    sptr symbol = new_symbol(name, value, type, symbols_table->arena);
+
+    if (!symbol) {
+        if (name) {
+            print_message(job, "Failed to create symbol - label name is a keyword.\n");
+            syntax_error(job, line, column, KEYWORD_LABEL);
+        } else
+            syntax_error(job, line, column, INVALID_LABEL);
+    } else if (!add_symbol(symbols_table, symbol)) {
+        print_message(job, "Failed to add symbol - label name already exists.\n");
+        syntax_error(job, line, column, DUPLICATE_LABEL);
+    }
+}
 
-    if (!(err = fopen("syntax_errors.txt", "r"))) {
-        return 0;
+
+/* Restores the outputs of an unchanged file from the cache directory, and reports a hit or a miss.
+ * Returns 1 on a hit, else returns 0 and keeps the key for storing the outputs at the end of the second pass */
+static int restore_outputs(asmptr job, srcptr source) {
+    Buffer files[TOTAL_CACHED_FILES];
+    char options[OPTIONS_KEY_LENGTH];
+    int hit;
+
+    /* the version and the options which change the outputs are hashed before the source */
+    sprintf(options, "%s %u %u %d\n", ASSEMBLER_VERSION, job->address, job->options->max_line_length,
+            job->options->binary);
+    init_cache_key(&job->cache_key);
+    hash_cache_key(&job->cache_key, options, strlen(options));
+    hash_cache_key(&job->cache_key, source->text, source->length);
+
+    hit = read_cache(job->options->cache_directory, &job->cache_key, files, job->arena);
+    print_message(job, hit ? "Cache hit. \n" : "Cache miss. \n");
+    if (hit && files[WARNINGS_FILE].length)
+        print_message(job, "%.*s", (int) files[WARNINGS_FILE].length, files[WARNINGS_FILE].data);
+    if (job->stats) {
+        job->stats->cache_hits += hit;
+        job->stats->cache_misses += !hit;
+        job->stats->files += hit;
     }
-    while (fgets(buf, MAX_ERROR_LENGTH, err)) {
-        printf("%s", buf);
-        count_errors++;
+
+    if (hit) {
+        create_file(job, &files[ENT_FILE], ".ent");
+        create_file(job, &files[EXT_FILE], ".ext");
+        create_file(job, &files[OB_FILE], ".ob");
+        if (job->options->binary)
+            create_file(job, &files[BO_FILE], OBJECT_EXTENSION);
     }
-    fclose(err);
 
-    remove("syntax_errors.txt");
-    return count_errors;
+    return hit;
 }
 
 
 /* Creates the .ob file by converting every memory word into 2 chars in base-64 representation */
-static void create_ob(char *file_name, wptr data_memory, wptr instruction_memory) {
-    FILE *fd;
-    wptr temp;
-    int upper_bits, lower_bits, count;
-    char base_64[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P', 'Q', 'R', 'S',
-                      'T', 'U', 'V', 'W', 'X', 'Y', 'Z', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l',
-                      'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '0', '1', '2', '3', '4',
-                      '5', '6', '7', '8', '9', '+', '/'};
-    char *name = create_file_name(file_name, ".ob");
-
-    if (!(fd = fopen(name, "w"))) {
-        openfile_error(name);
-        return;
-    }
+static void create_ob(asmptr job, segptr data_memory, segptr instruction_memory, bufptr buffer) {
+    append_counts(buffer, instruction_memory->length, data_memory->length);
+    append_words(buffer, instruction_memory);
+    append_words(buffer, data_memory);
 
-    for (temp = instruction_memory, count = 0; temp; temp = temp->next, count++);
-    fprintf(fd, "%d ", count);
-    for (temp = data_memory, count = 0; temp; temp = temp->next, count++);
-    fprintf(fd, "%d\n", count);
+    create_file(job, buffer, ".ob");
+}
 
-    for (temp = instruction_memory; temp; temp = temp->next) {
-        upper_bits = convert_binary_to_decimal(temp->binary_code, UPPER);
-        lower_bits = convert_binary_to_decimal(temp->binary_code, LOWER);
-        fprintf(fd, "%c%c\n", base_64[upper_bits], base_64[lower_bits]);
-    }
-    for (temp = data_memory; temp; temp = temp->next) {
-        upper_bits = convert_binary_to_decimal(temp->binary_code, UPPER);
-        lower_bits = convert_binary_to_decimal(temp->binary_code, LOWER);
-        fprintf(fd, "%c%c\n", base_64[upper_bits], base_64[lower_bits]);
-    }
 
+/* Creates the binary object file, which holds the words, the entries, the externals and the relocations at once */
+static void create_bo(asmptr job, tptr symbols_table, segptr data_memory, segptr instruction_memory, bufptr buffer) {
+    append_object(buffer, symbols_table, data_memory, instruction_memory);
 
-    printf("file created: '%s' \n", name);
-    free(name);
-    fclose(fd);
+    create_file(job, buffer, OBJECT_EXTENSION);
 }
 
 
 /* Creates the .ent file by scanning the symbols table for symbols with 'entry' type */
-static void create_ent(char *file_name, sptr symbols_table) {
-    FILE *fd;
+static void create_ent(asmptr job, tptr symbols_table, bufptr buffer) {
     sptr temp;
-    int check = 0;
-    char *name = create_file_name(file_name, ".ent");
-
-    if (!(fd = fopen(name, "w"))) {
-        openfile_error(name);
-        return;
-    }
 
-    for (temp = symbols_table; temp; temp = temp->next) {
-        if (temp->type == ENTRY_SYMBOL) {
-            fprintf(fd, "%-10s %d\n", temp->name, temp->value);
-            check++;
-        }
+    for (temp = symbols_table->head; temp; temp = temp->next) {
+        if (temp->type == ENTRY_SYMBOL)
+            append_symbol(buffer, temp->name, temp->value);
     }
 
-    fclose(fd);
-
-    if (!check) {
-        remove(name);
-        free(name);
-        return;
-    }
-
-    printf("file created: '%s' \n", name);
-    free(name);
+    create_file(job, buffer, ".ent");
 }
 
 
 /* Creates the .ext file by scanning the memory for words with 'ext' field */
-static void create_ext(char *file_name, wptr instruction_memory) {
-    FILE *fd;
-    wptr temp;
-    int check = 0;
-    char *name = create_file_name(file_name, ".ext");
-
-    if (!(fd = fopen(name, "w"))) {
-        openfile_error(name);
-        return;
-    }
+static void create_ext(asmptr job, segptr instruction_memory, bufptr buffer) {
+    unsigned int i;
 
-    for (temp = instruction_memory; temp; temp = temp->next) {
-        if (temp->ext) {
-            fprintf(fd, "%-10s %d\n", temp->ext, temp->address);
-            check++;
-        }
+    for (i = 0; i < instruction_memory->length; i++) {
+        if (instruction_memory->words[i].ext)
+            append_symbol(buffer, instruction_memory->words[i].ext, instruction_memory->base + i);
     }
 
-    fclose(fd);
+    create_file(job, buffer, ".ext");
+}
+
 
-    if (!check) {
+/* Writes an output file with a given extension. An empty file isn't created, and an old one is removed */
+static void create_file(asmptr job, bufptr buffer, char *extension) {
+    char *name = create_file_name(job, extension);
+
+    if (!buffer->length)
         remove(name);
-        free(name);
-        return;
+    else if ((job->options->output_directory && !create_directories(name)) || !write_buffer(buffer, name))
+        openfile_error(job, name);
+    else {
+        print_message(job, "file created: '%s' \n", name);
+        if (job->stats)
+            job->stats->output_bytes += buffer->length;
     }
 
-    printf("file created: '%s' \n", name);
     free(name);
 }
 
 
-/* Returns a string of a file name with a specified extension */
-static char *create_file_name(char *file_name, char *extension) {
-    unsigned int i;
-    char *name;
+/* Adds the counters of a finished job to its statistics */
+static void collect_stats(asmptr job, aptr arena, tptr symbols_table, segptr data_memory, segptr instruction_memory) {
+    statptr stats = job->stats;
 
-    for (i = 0; file_name[i] != '.'; i++);
+    if (!stats)
+        return;
 
-    if (!(name = (char *) malloc(((i + strlen(extension)) * sizeof(char)) + 1)))
+    stats->files++;
+    stats->symbols += symbols_table->count;
+    stats->code_words += instruction_memory ? instruction_memory->length : 0;
+    stats->data_words += data_memory->length;
+    stats->searches += symbols_table->searches;
+    stats->comparisons += symbols_table->comparisons;
+    stats->allocations += arena->allocations;
+    stats->allocated += arena->allocated;
+}
+
+
+/* Returns the name of an output file - the name of the source with another extension.
+ * The file is placed in the output directory if there is one, at the same relative path as the source */
+static char *create_file_name(asmptr job, char *extension) {
+    char *directory = job->options->output_directory, *source = job->file_name, *name;
+    size_t length = strlen(source) - EXT_LENGTH;        /* without the '.as' */
+
+    if (!(name = (char *) malloc((directory ? strlen(directory) + 1 : 0) + length + strlen(extension) + 1)))
         exit(allocate_error("create_file_name"));
 
-    strncpy(name, file_name, i);
-    name[i] = '\0';
+    name[0] = '\0';
+    if (directory) {
+        strcpy(name, directory);
+        append_relative_path(name, source, length);
+    } else
+        strncat(name, source, length);
     strcat(name, extension);
 
     return name;
 }
 
 
-/* Adding '.as' to the file name */
+/* Appends the first 'length' characters of a path to a directory, without its '/', '.' and '..' components,
+ * so the path always stays under the directory */
+static void append_relative_path(char *directory, char *path, size_t length) {
+    char *end = path + length, *next;
+    size_t size, start = strlen(directory);
+
+    for (; path < end; path = next + 1) {
+        if (!(next = (char *) memchr(path, '/', (size_t) (end - path))))
+            next = end;
+        size = (size_t) (next - path);
+        if (!size || (size == 1 && path[0] == '.') || (size == 2 && path[0] == '.' && path[1] == '.'))
+            continue;
+        strcat(directory, "/");
+        strncat(directory, path, size);
+    }
+    if (strlen(directory) == start)         /* a source named '.as' */
+        strcat(directory, "/");
+}
+
+
+/* Adding '.as' to the file name, unless it's already there */
 static char *get_file_name(char *file_name) {
-    unsigned int i;
+    size_t length = strlen(file_name);
     char *name;
 
-    for (i = 0; file_name[i] != '\0'; i++);
-    i += EXT_LENGTH;   /* adding 3 for the '.as' */
-
-    if (!(name = (char *) malloc((i * sizeof(char))) + 1))
+    if (!(name = (char *) malloc(length + EXT_LENGTH + 1)))
         exit(allocate_error("get_file_name"));
 
-    strncpy(name, file_name, i);
-    name[i] = '\0';
-    strcat(name, ".as");
+    strcpy(name, file_name);
+    if (length < EXT_LENGTH || strcmp(file_name + length - EXT_LENGTH, ".as"))
+        strcat(name, ".as");
 
     return name;
 }
 
 
-/* Converts a specific half of a given data word into a decimal number */
-static int convert_binary_to_decimal(const short *word, int part) {
-    int i, res = 0;
-
-    if (part == UPPER) {
-        for (i = 0; i < HALF; i++)
-            res += (int) (word[i] * pow(BIN, (HALF - 1 - i)));
-    } else if (part == LOWER) {
-        for (i = 0; i < HALF; i++)
-            res += (int) (word[HALF + i] * pow(2, (HALF - 1 - i)));
-    }
-
-    return res;
+/* Assembling errors (syntax error) - collected in the diagnostics of the job until the end of the pass */
+static void syntax_error(asmptr job, unsigned int line, unsigned int column, ErrorCode code) {
+    add_diagnostic(&job->diagnostics, line, column, code);
 }
 
 
-/* Returns a pointer to the next non-space character */
-static char *skip_spaces(char *address) {
-    while (isspace(*address))
-        address++;
-    return address;
-}
-
-
-/* Assembling errors (syntax error) */
-static void syntax_error(unsigned int line, char *str) {
-    FILE *err;
+/* Prints a message of the job, unless the job has no stream for messages */
+static void print_message(asmptr job, const char *format, ...) {
+    va_list arguments;
 
-    if (!(err = fopen("syntax_errors.txt", "a+"))) {
-        openfile_error("syntax_error");
+    if (!job->out)
         return;
-    }
 
-    fprintf(err, "ERROR: in line %d - %s\n", line, str);
+    va_start(arguments, format);
+    vfprintf(job->out, format, arguments);
+    va_end(arguments);
+}
+
 
-    fclose(err);
+/* Prints a warning, and keeps it for the cache entry of the job */
+static void print_warning(asmptr job, const char *message) {
+    print_message(job, "%s", message);
+    if (job->options->cache_directory)
+        append_string(&job->warnings, message);
 }
 
 
-/* Printing a message when fails to open a file */
-static int openfile_error(char *file_name) {
-    fprintf(stderr, "*** ERROR: failed to open '%s' *** \n", file_name);
+/* Printing a message when fails to open a file, in order with the other messages of the job */
+static int openfile_error(asmptr job, char *file_name) {
+    print_message(job, "*** ERROR: failed to open '%s' *** \n", file_name);
     return 0;
 }
 
@@ -1,25 +1,80 @@
 #ifndef PROJECT_ASSEMBLE_H
 #define PROJECT_ASSEMBLE_H
 
+#include <stdio.h>
+#include "diagnostics.h"
+#include "stats.h"
+#include "cache.h"
+#include "source.h"
+
 
-#define MAX_LINE_LENGTH 82          /* Maximum character in a line */
 #define DEFAULT_ADDRESS 100         /* Default address for assembling */
+#define ASSEMBLER_VERSION "1.2"     /* Part of the cache keys - should change whenever the outputs change */
+#define DEFAULT_CACHE_SIZE (64UL * 1024 * 1024)     /* Default size limit of the cache directory, in bytes */
+
+
+/* Options of the assembler */
+typedef struct options *optptr;
+typedef struct options {
+    unsigned int address;           /* Address of the first instruction */
+    unsigned int max_errors;        /* A pass stops after this many errors, 0 for no limit */
+    unsigned int max_line_length;   /* Longer lines are errors, 0 for no limit */
+    DiagnosticsFormat error_format; /* Format of the printed errors */
+    int jobs;                       /* Number of files assembled at once, 0 to assemble them one by one */
+    int one_pass;                   /* Store the instructions on the first pass, and patch the labels at the end */
+    int stats;                      /* Collect statistics of the run */
+    DiagnosticsFormat stats_format; /* Format of the printed statistics */
+    char *cache_directory;          /* Directory of the build cache, NULL if there's no cache */
+    unsigned long cache_size;       /* The cache is evicted down to this many bytes */
+    char *server;                   /* Socket of the server mode, "-" to serve the standard input, NULL for no server */
+    char *output_directory;         /* The outputs are written to this directory, NULL to write them next to the sources */
+    int binary;                     /* Also write the binary object file */
+    int threads;                    /* A large file is assembled in chunks on this many threads, 0 for a single thread */
+} Options;
+
+
+/* The outputs of a source assembled in memory, declared by the library */
+typedef struct assembly_result *resptr;
+
+
+/* An assembling job - the state of a single source file which is shared by the passes */
+typedef struct assembly *asmptr;
+typedef struct assembly {
+    char *file_name;                /* Name of the source file, including '.as' */
+    unsigned int address;           /* Address of the first instruction */
+    optptr options;
+    FILE *out;                      /* Messages of the job are printed to this stream, NULL for no messages */
+    Diagnostics diagnostics;        /* Syntax errors of the job */
+    statptr stats;                  /* The statistics of the job are added here, NULL if they aren't collected */
+    CacheKey cache_key;             /* Hash of the source and the options, used only with a cache directory */
+    Buffer warnings;                /* The printed warnings, which are stored in the cache with the outputs */
+    aptr arena;                     /* Owns all the memory of the job */
+    resptr result;                  /* The outputs are returned here instead of written to files, unless it's NULL */
+} Assembly;
+
+
+/* Set the default options of the assembler */
+void default_options(optptr options);
 
 
 /* Launching the assembler by calling 'first_pass' */
 int assemble(char *file_name, unsigned int address);
 
 
-/* Check if a line is empty */
-int is_empty(const char *instruction);
+/* Launching the assembler with the given options, the messages of the job are printed to 'out' */
+int assemble_to(char *file_name, optptr options, FILE *out);
+
+
+/* Launching the assembler like 'assemble_to', and adding the statistics of the job to 'stats' unless it's NULL */
+int assemble_file(char *file_name, optptr options, FILE *out, statptr stats);
 
 
-/* Check if a line is a comment */
-int is_comment(char *statement);
+/* Assembles a source of a job whose fields are all set. Returns 1 on success, else returns 0 */
+int assemble_source(asmptr job, srcptr source);
 
 
-/* Print syntax errors */
-int get_errors();
+/* Print the syntax errors found since the last call. Returns the number of errors printed */
+int get_errors(asmptr job);
 
 
 #endif
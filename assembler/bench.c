@@ -0,0 +1,194 @@
+/*
+ *  This file is the benchmark harness of the assembler.
+ *  Every given file is assembled once, and its speed and the peak memory of the process are reported.
+ *  The output files are removed after they are measured, so the benchmark leaves only its sources.
+ *
+ * */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "assemble.h"
+
+
+#define NANOSECONDS 1e9
+#define OB_EXTENSION ".ob"
+
+static char *output_extensions[] = {OB_EXTENSION, ".ent", ".ext"};
+
+enum {
+    FALSE, TRUE
+};
+
+
+static void bench_file(char *file_name, optptr options, FILE *out);
+
+static unsigned long count_lines(char *file_name);
+
+static unsigned long count_words(char *file_name);
+
+static void remove_outputs(char *file_name);
+
+static char *create_file_name(char *file_name, char *extension);
+
+static double get_time(void);
+
+static long get_peak_rss(void);
+
+static int allocate_error(char *func);
+
+
+int main(int argc, char *argv[]) {
+    int i;
+    FILE *out;
+    Options options;
+
+    default_options(&options);
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "--one-pass"))
+            options.one_pass = TRUE;
+        else {
+            fprintf(stderr, "Usage: %s [--one-pass] file...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!(out = fopen("/dev/null", "w"))) {       /* the messages of the assembler aren't part of the benchmark */
+        fprintf(stderr, "*** ERROR: failed to open '/dev/null' *** \n");
+        return 1;
+    }
+
+    printf("%-32s %10s %10s %9s %12s %12s %12s\n", "file", "lines", "words", "seconds", "lines/sec", "words/sec",
+           "peak RSS KB");
+    for (; i < argc; i++)
+        bench_file(argv[i], &options, out);
+
+    fclose(out);
+
+    return 0;
+}
+
+
+/* Assembles a single file and prints its results. The peak RSS is of the whole process so far,
+ * so the files should be given from the smallest to the largest */
+static void bench_file(char *file_name, optptr options, FILE *out) {
+    char *source_name = create_file_name(file_name, ".as");
+    unsigned long lines = count_lines(source_name), words = 0;
+    double start, seconds;
+    char *object_name;
+
+    start = get_time();
+    if (assemble_to(file_name, options, out)) {
+        seconds = get_time() - start;
+        object_name = create_file_name(file_name, OB_EXTENSION);
+        words = count_words(object_name);
+        free(object_name);
+        remove_outputs(file_name);
+    } else
+        seconds = get_time() - start;
+
+    if (seconds <= 0)
+        seconds = 1 / NANOSECONDS;
+
+    printf("%-32s %10lu %10lu %9.4f %12.0f %12.0f %12ld\n", file_name, lines, words, seconds, lines / seconds,
+           words / seconds, get_peak_rss());
+    fflush(stdout);
+    free(source_name);
+}
+
+
+/* Returns the number of lines in a file, or 0 if it can't be opened */
+static unsigned long count_lines(char *file_name) {
+    FILE *fd;
+    char buf[BUFSIZ];
+    size_t i, length;
+    unsigned long lines = 0;
+
+    if (!(fd = fopen(file_name, "r")))
+        return 0;
+
+    while ((length = fread(buf, 1, sizeof(buf), fd)) > 0) {
+        for (i = 0; i < length; i++)
+            lines += (buf[i] == '\n');
+    }
+
+    fclose(fd);
+
+    return lines;
+}
+
+
+/* Returns the number of words in an object file by its header, or 0 if it can't be opened */
+static unsigned long count_words(char *file_name) {
+    FILE *fd;
+    unsigned long instructions = 0, data = 0;
+
+    if (!(fd = fopen(file_name, "r")))
+        return 0;
+
+    if (fscanf(fd, "%lu %lu", &instructions, &data) != 2)
+        instructions = data = 0;
+
+    fclose(fd);
+
+    return instructions + data;
+}
+
+
+/* Removes the output files of an assembled file */
+static void remove_outputs(char *file_name) {
+    char *name;
+    size_t i;
+
+    for (i = 0; i < sizeof(output_extensions) / sizeof(output_extensions[0]); i++) {
+        name = create_file_name(file_name, output_extensions[i]);
+        remove(name);
+        free(name);
+    }
+}
+
+
+/* Returns a string of a file name with a specified extension */
+static char *create_file_name(char *file_name, char *extension) {
+    char *name;
+
+    if (!(name = (char *) malloc(strlen(file_name) + strlen(extension) + 1)))
+        exit(allocate_error("create_file_name"));
+
+    strcpy(name, file_name);
+    strcat(name, extension);
+
+    return name;
+}
+
+
+/* Returns the time in seconds from an arbitrary point */
+static double get_time(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / NANOSECONDS;
+}
+
+
+/* Returns the peak resident memory of the process in KB */
+static long get_peak_rss(void) {
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+    return usage.ru_maxrss;
+}
+
+
+/* Memory allocation fail */
+static int allocate_error(char *func) {
+    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
+    return 1;
+}
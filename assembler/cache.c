@@ -0,0 +1,270 @@
+/* This file is implementing the build cache of the assembler.
+ * The outputs of an assembled file are kept in a single entry, named by a hash of the source and the options,
+ * so an unchanged file is restored without assembling it. An entry also holds two more hashes and the length of
+ * the hashed input, which must match on a hit, so a collision of the names alone never restores wrong outputs. An entry is written to a temporary file and renamed,
+ * so parallel jobs never see a partial entry. The modification time of an entry is its last use. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include "cache.h"
+
+
+#define CACHE_MAGIC "ASCACHE4"
+#define HEADER_LENGTH 256
+#define PATH_LENGTH (CACHE_NAME_LENGTH + 64)
+#define HASH_MASK 0xFFFFFFFFUL
+#define FNV_OFFSET 0x811C9DC5UL
+#define FNV_PRIME 0x01000193UL
+#define DJB_OFFSET 5381UL
+#define INITIAL_ENTRIES 64
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* An entry found in the cache directory */
+typedef struct cache_entry {
+    char name[CACHE_NAME_LENGTH + 1];
+    unsigned long size;
+    struct timespec used;           /* Modification time of the entry */
+} CacheEntry;
+
+
+static char *get_entry_path(const char *directory, const char *name);
+
+static void get_entry_name(keyptr key, char *name);
+
+static int is_entry_name(const char *name);
+
+static int compare_entries(const void *a, const void *b);
+
+static int allocate_error(char *func);
+
+
+/* Initialize the key of an empty input */
+void init_cache_key(keyptr key) {
+    key->high = 0;
+    key->low = FNV_OFFSET;
+    key->check_high = DJB_OFFSET;
+    key->check_low = 0;
+    key->length = 0;
+}
+
+
+/* Adds 'length' bytes to the hashed input of a key.
+ * The name is FNV-1a and sdbm, and the check is djb2 and one-at-a-time, so a false hit needs all of them to collide */
+void hash_cache_key(keyptr key, const char *data, size_t length) {
+    unsigned long high = key->high, low = key->low, check_high = key->check_high, check_low = key->check_low, c;
+    size_t i;
+
+    for (i = 0; i < length; i++) {
+        c = (unsigned char) data[i];
+        low = ((low ^ c) * FNV_PRIME) & HASH_MASK;
+        high = (c + (high << 6) + (high << 16) - high) & HASH_MASK;
+        check_high = ((check_high << 5) + check_high + c) & HASH_MASK;
+        check_low = (check_low + c) & HASH_MASK;
+        check_low = (check_low + (check_low << 10)) & HASH_MASK;
+        check_low ^= check_low >> 6;
+    }
+
+    key->high = high;
+    key->low = low;
+    key->check_high = check_high;
+    key->check_low = check_low;
+    key->length = (key->length + (unsigned long) length) & HASH_MASK;
+}
+
+
+/* Reads the outputs of a key from the cache directory into 'files'. Returns 1 on a hit, else returns 0 */
+int read_cache(const char *directory, keyptr key, Buffer files[], aptr arena) {
+    char name[CACHE_NAME_LENGTH + 1], header[HEADER_LENGTH], magic[HEADER_LENGTH], *path, *data;
+    unsigned long lengths[TOTAL_CACHED_FILES], total, check_high, check_low, hashed;
+    long offset, size;
+    FILE *fd;
+    int i, hit = FALSE;
+
+    get_entry_name(key, name);
+    path = get_entry_path(directory, name);
+    if (!(fd = fopen(path, "rb"))) {
+        free(path);
+        return FALSE;
+    }
+
+    if (fgets(header, HEADER_LENGTH, fd) &&
+        sscanf(header, "%s %lx %lx %lu %lu %lu %lu %lu %lu", magic, &check_high, &check_low, &hashed,
+               &lengths[OB_FILE], &lengths[ENT_FILE], &lengths[EXT_FILE], &lengths[BO_FILE],
+               &lengths[WARNINGS_FILE]) == 9 &&
+        !strcmp(magic, CACHE_MAGIC) && check_high == key->check_high && check_low == key->check_low &&
+        hashed == key->length && (offset = ftell(fd)) >= 0 && !fseek(fd, 0, SEEK_END) &&
+        (size = ftell(fd)) >= 0 && !fseek(fd, offset, SEEK_SET)) {
+        for (i = 0, total = 0; i < TOTAL_CACHED_FILES; i++)
+            total += lengths[i];
+        data = NULL;
+        if ((unsigned long) (size - offset) == total)        /* else the entry is damaged */
+            data = (char *) arena_alloc(arena, total + 1);
+        if (data && fread(data, 1, total, fd) == total) {
+            for (i = 0; i < TOTAL_CACHED_FILES; i++) {
+                init_buffer(&files[i], arena);
+                files[i].data = data;
+                files[i].length = files[i].capacity = lengths[i];
+                data += lengths[i];
+            }
+            hit = TRUE;
+        }
+    }
+    fclose(fd);
+
+    if (hit)
+        utime(path, NULL);              /* marks the entry as recently used */
+    free(path);
+
+    return hit;
+}
+
+
+/* Stores the outputs of a key in the cache directory, which is created if needed. Returns 1 on success, else returns 0 */
+int write_cache(const char *directory, keyptr key, Buffer files[]) {
+    char name[CACHE_NAME_LENGTH + 1], *path, *temp;
+    FILE *fd;
+    int i, success;
+
+    if (mkdir(directory, 0777) && errno != EEXIST)
+        return FALSE;
+
+    get_entry_name(key, name);
+    path = get_entry_path(directory, name);
+    if (!(temp = (char *) malloc(strlen(path) + PATH_LENGTH)))
+        exit(allocate_error("write_cache"));
+    /* the process and the buffers tell apart the temporary files of all the jobs which write the same entry */
+    sprintf(temp, "%s.%ld.%lx.tmp", path, (long) getpid(), (unsigned long) files);
+
+    if (!(fd = fopen(temp, "wb"))) {
+        free(temp);
+        free(path);
+        return FALSE;
+    }
+
+    success = fprintf(fd, "%s %08lx %08lx %lu %lu %lu %lu %lu %lu\n", CACHE_MAGIC, key->check_high, key->check_low,
+                      key->length, (unsigned long) files[OB_FILE].length,
+                      (unsigned long) files[ENT_FILE].length, (unsigned long) files[EXT_FILE].length,
+                      (unsigned long) files[BO_FILE].length, (unsigned long) files[WARNINGS_FILE].length) > 0;
+    for (i = 0; i < TOTAL_CACHED_FILES; i++) {
+        if (files[i].length && fwrite(files[i].data, 1, files[i].length, fd) != files[i].length)
+            success = FALSE;
+    }
+    if (fclose(fd))
+        success = FALSE;
+
+    if (!success || rename(temp, path)) {
+        remove(temp);
+        success = FALSE;
+    }
+
+    free(temp);
+    free(path);
+
+    return success;
+}
+
+
+/* Removes the least recently used entries until the cache directory takes at most 'max_size' bytes.
+ * Returns the number of removed entries */
+int evict_cache(const char *directory, unsigned long max_size) {
+    DIR *dir;
+    struct dirent *file;
+    struct stat info;
+    CacheEntry *entries = NULL, *new;
+    unsigned int count = 0, capacity = 0, i;
+    unsigned long total = 0;
+    char *path;
+    int removed = 0;
+
+    if (!(dir = opendir(directory)))
+        return 0;
+
+    while ((file = readdir(dir))) {
+        if (!is_entry_name(file->d_name))
+            continue;
+
+        path = get_entry_path(directory, file->d_name);
+        if (!stat(path, &info) && S_ISREG(info.st_mode)) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : INITIAL_ENTRIES;
+                if (!(new = (CacheEntry *) realloc(entries, capacity * sizeof(CacheEntry))))
+                    exit(allocate_error("evict_cache"));
+                entries = new;
+            }
+            strcpy(entries[count].name, file->d_name);
+            entries[count].size = (unsigned long) info.st_size;
+            entries[count].used = info.st_mtim;
+            total += entries[count++].size;
+        }
+        free(path);
+    }
+    closedir(dir);
+
+    if (total > max_size) {
+        qsort(entries, count, sizeof(CacheEntry), compare_entries);
+        for (i = 0; i < count && total > max_size; i++) {
+            path = get_entry_path(directory, entries[i].name);
+            if (!remove(path)) {
+                total -= entries[i].size;
+                removed++;
+            }
+            free(path);
+        }
+    }
+
+    free(entries);
+
+    return removed;
+}
+
+
+/* Returns the path of an entry in the cache directory, which should be freed */
+static char *get_entry_path(const char *directory, const char *name) {
+    char *path;
+
+    if (!(path = (char *) malloc(strlen(directory) + strlen(name) + 2)))
+        exit(allocate_error("get_entry_path"));
+    sprintf(path, "%s/%s", directory, name);
+
+    return path;
+}
+
+
+/* Writes the name of the entry of a key - the two hashes in hex */
+static void get_entry_name(keyptr key, char *name) {
+    sprintf(name, "%08lx%08lx", key->high & HASH_MASK, key->low & HASH_MASK);
+}
+
+
+/* Checks if a file name is the name of an entry, so other files in the directory are never evicted */
+static int is_entry_name(const char *name) {
+    return (strlen(name) == CACHE_NAME_LENGTH && strspn(name, "0123456789abcdef") == CACHE_NAME_LENGTH);
+}
+
+
+/* Orders the entries from the least recently used */
+static int compare_entries(const void *a, const void *b) {
+    const struct timespec *first = &((const CacheEntry *) a)->used, *second = &((const CacheEntry *) b)->used;
+
+    if (first->tv_sec != second->tv_sec)
+        return (first->tv_sec > second->tv_sec) - (first->tv_sec < second->tv_sec);
+    return (first->tv_nsec > second->tv_nsec) - (first->tv_nsec < second->tv_nsec);
+}
+
+
+static int allocate_error(char *func) {
+    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
+    return 1;
+}
@@ -0,0 +1,50 @@
+#ifndef PROJECT_CACHE_H
+#define PROJECT_CACHE_H
+
+#include <stddef.h>
+#include "output.h"
+
+
+#define CACHE_NAME_LENGTH 16        /* Number of hex digits in the name of an entry */
+
+
+/* The outputs of an assembly, in the order they are stored in a cache entry.
+ * The warnings are kept with the files, so they are printed again on a hit */
+typedef enum cached_file {
+    OB_FILE, ENT_FILE, EXT_FILE, BO_FILE, WARNINGS_FILE, TOTAL_CACHED_FILES
+} CachedFile;
+
+
+/* A hash of everything the outputs of an assembly depend on. Built by 'hash_cache_key' */
+typedef struct cache_key *keyptr;
+typedef struct cache_key {
+    unsigned long high;             /* Two independent 32 bit hashes which name the entry, as C90 has no 64 bit integer */
+    unsigned long low;
+    unsigned long check_high;       /* Two more 32 bit hashes, which are stored in the entry and compared on a hit */
+    unsigned long check_low;
+    unsigned long length;           /* Number of hashed bytes, also compared on a hit */
+} CacheKey;
+
+
+/* Initialize the key of an empty input */
+void init_cache_key(keyptr key);
+
+
+/* Adds 'length' bytes to the hashed input of a key */
+void hash_cache_key(keyptr key, const char *data, size_t length);
+
+
+/* Reads the outputs of a key from the cache directory into 'files'. Returns 1 on a hit, else returns 0 */
+int read_cache(const char *directory, keyptr key, Buffer files[], aptr arena);
+
+
+/* Stores the outputs of a key in the cache directory, which is created if needed. Returns 1 on success, else returns 0 */
+int write_cache(const char *directory, keyptr key, Buffer files[]);
+
+
+/* Removes the least recently used entries until the cache directory takes at most 'max_size' bytes.
+ * Returns the number of removed entries */
+int evict_cache(const char *directory, unsigned long max_size);
+
+
+#endif
@@ -0,0 +1,318 @@
+/* This file is implementing the assembling of a single large source on several threads.
+ * The source is split into chunks of whole lines, and every chunk is parsed and sized by a thread of its own,
+ * with its own counters, symbols and data. The addresses of the chunks are a prefix sum of their counters,
+ * their symbols are merged in order, and then every chunk is encoded by a thread of its own against the merged table.
+ * A source with any error or warning is left to the serial passes, which report them in order,
+ * so the outputs of the chunks are always the outputs of the serial passes. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "chunks.h"
+
+
+enum {
+    FALSE, TRUE
+};
+
+
+static void run_chunks(chkptr chunks, void *(*phase)(void *), aptr arena);
+
+static void *size_chunk(void *arg);
+
+static void size_statement(Chunk *chunk, stmtptr statement);
+
+static void define_label(Chunk *chunk, char *name, unsigned int value, SymbolType type);
+
+static void *encode_chunk(void *arg);
+
+
+/* Splits a source into at most 'threads' chunks of whole lines.
+ * Returns 1 on success, or 0 if the source is too small to be split */
+int split_source(chkptr chunks, srcptr source, int threads, unsigned int address, aptr arena) {
+    char *start = source->text, *end = source->text + source->length, *next;
+    int count = threads, i;
+
+    if ((unsigned long) count > source->length / MIN_CHUNK_SIZE)
+        count = (int) (source->length / MIN_CHUNK_SIZE);
+    if (count < 2)
+        return FALSE;
+
+    chunks->list = (Chunk *) arena_calloc(arena, (size_t) count * sizeof(Chunk));
+    chunks->count = 0;
+    chunks->address = address;
+    chunks->allocations = 0;
+    chunks->allocated = 0;
+    for (i = 1; i <= count && start < end; i++) {          /* every chunk ends after the line of its share */
+        next = source->text + source->length / (size_t) count * (size_t) i;
+        if (next < start)
+            next = start;
+        if (i == count || !(next = (char *) memchr(next, '\n', (size_t) (end - next))))
+            next = end;
+        else
+            next++;
+        if (next <= start)
+            continue;
+
+        chunks->list[chunks->count].start = start;
+        chunks->list[chunks->count].end = next;
+        chunks->list[chunks->count].arena = new_arena();
+        chunks->count++;
+        start = next;
+    }
+
+    return TRUE;
+}
+
+
+/* Parses the lines of every chunk and counts its words on a thread of its own - the first pass of the chunks.
+ * Returns 1 on success, or 0 if a chunk has an error or a warning, which are reported by the serial passes */
+int size_chunks(chkptr chunks, unsigned int max_line_length, aptr arena) {
+    Chunk *chunk, *end = chunks->list + chunks->count;
+
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        chunk->max_line_length = max_line_length;
+        chunk->statements = new_statements(chunk->arena);
+        chunk->symbols_table = new_symbols_table(chunk->arena);
+        chunk->data_memory = new_segment(0, chunk->arena);
+    }
+
+    run_chunks(chunks, size_chunk, arena);
+
+    chunks->lines = 0;
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        if (chunk->failed)
+            return FALSE;
+        chunks->lines += chunk->lines;
+    }
+
+    return TRUE;
+}
+
+
+/* Places the chunks by a prefix sum of their counters, and merges their symbols and their data in order.
+ * Returns the merged symbols table, or NULL if a label is defined twice or an external is an entry */
+tptr merge_chunks(chkptr chunks, segptr data_memory, aptr arena) {
+    Chunk *chunk, *end = chunks->list + chunks->count;
+    unsigned int code_address = chunks->address, data_offset = 0;
+    Statement *statement, *last;
+    sptr symbol, next;
+    tptr symbols_table;
+
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        chunk->code_address = code_address;
+        chunk->data_offset = data_offset;
+        code_address += chunk->instruction_counter;
+        data_offset += chunk->data_memory->length;
+    }
+    chunks->code_length = code_address - chunks->address;
+    chunks->data_length = data_offset;
+
+    /* the symbols are added by the order of their lines, like the serial first pass adds them */
+    symbols_table = new_symbols_table(arena);
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        for (symbol = chunk->symbols_table->head; symbol; symbol = next) {
+            next = symbol->next;
+            if (symbol->type == CODE_SYMBOL)
+                symbol->value += chunk->code_address;
+            else if (symbol->type == DATA_SYMBOL)
+                symbol->value += data_memory->base + chunk->data_offset;
+            symbol->next = symbol->prev = NULL;
+            if (!add_symbol(symbols_table, symbol))
+                return NULL;
+        }
+    }
+    update_symbols(symbols_table, &chunks->code_length);
+
+    reserve_words(data_memory, chunks->data_length);
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        if (chunk->data_memory->length)
+            memcpy(data_memory->words + chunk->data_offset, chunk->data_memory->words,
+                   chunk->data_memory->length * sizeof(Word));
+    }
+    data_memory->length = chunks->data_length;
+
+    /* an external which is an entry changes the encoding of its later uses, so it's left to the serial passes */
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        last = chunk->statements->list + chunk->statements->count;
+        for (statement = chunk->statements->list; statement < last; statement++) {
+            if (statement->kind != OPERATION_STATEMENT &&
+                (symbol = find_symbol(symbols_table, statement->dst.text.start, statement->dst.text.length)) &&
+                symbol->type == EXTERN_SYMBOL)
+                return NULL;
+        }
+    }
+
+    return symbols_table;
+}
+
+
+/* Encodes the instructions of every chunk on a thread of its own, against the merged symbols table,
+ * and marks the entries - the second pass of the chunks. Returns the instruction memory */
+segptr encode_chunks(chkptr chunks, tptr symbols_table, aptr arena) {
+    Chunk *chunk, *end = chunks->list + chunks->count;
+    Statement *statement, *last;
+    segptr instruction_memory = new_segment(chunks->address, arena);
+
+    /* every chunk gets its part of the memory - a segment which never grows, as the space
+     * reserved before an instruction is stored may reach into the part of the next chunk */
+    reserve_words(instruction_memory, chunks->code_length + MAX_INSTRUCTION_LENGTH);
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        chunk->code.words = instruction_memory->words + (chunk->code_address - chunks->address);
+        chunk->code.length = 0;
+        chunk->code.capacity = chunk->instruction_counter + MAX_INSTRUCTION_LENGTH;
+        chunk->code.base = chunk->code_address;
+        chunk->code.arena = chunk->arena;
+        chunk->view = *symbols_table;
+        chunk->view.searches = chunk->view.comparisons = 0;
+    }
+
+    run_chunks(chunks, encode_chunk, arena);
+    instruction_memory->length = chunks->code_length;
+
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        symbols_table->searches += chunk->view.searches;
+        symbols_table->comparisons += chunk->view.comparisons;
+
+        last = chunk->statements->list + chunk->statements->count;
+        for (statement = chunk->statements->list; statement < last; statement++) {
+            if (statement->kind != OPERATION_STATEMENT)
+                set_entry(symbols_table, statement->dst.text.start, statement->dst.text.length);
+        }
+    }
+
+    return instruction_memory;
+}
+
+
+/* Restores the lines which were terminated in place, so the serial passes can read the source again */
+void restore_source(chkptr chunks) {
+    Chunk *chunk, *end = chunks->list + chunks->count;
+    char *current;
+
+    for (chunk = chunks->list; chunk < end; chunk++) {
+        if (!chunk->terminated)
+            continue;
+        for (current = chunk->start;
+             (current = (char *) memchr(current, '\0', (size_t) (chunk->end - current))); current++)
+            *current = '\n';
+    }
+}
+
+
+/* Frees the memory of the chunks */
+void delete_chunks(chkptr chunks) {
+    int i;
+
+    for (i = 0; i < chunks->count; i++) {
+        chunks->allocations += chunks->list[i].arena->allocations;
+        chunks->allocated += chunks->list[i].arena->allocated;
+        delete_arena(chunks->list[i].arena);
+    }
+    chunks->count = 0;
+}
+
+
+/* Runs a phase on every chunk, all the chunks at once. A chunk whose thread can't be created runs on this thread */
+static void run_chunks(chkptr chunks, void *(*phase)(void *), aptr arena) {
+    pthread_t *threads = (pthread_t *) arena_alloc(arena, (size_t) chunks->count * sizeof(pthread_t));
+    int *started = (int *) arena_calloc(arena, (size_t) chunks->count * sizeof(int));
+    int i;
+
+    for (i = 1; i < chunks->count; i++)
+        started[i] = !pthread_create(&threads[i], NULL, phase, &chunks->list[i]);
+    phase(&chunks->list[0]);
+
+    for (i = 1; i < chunks->count; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            phase(&chunks->list[i]);
+    }
+}
+
+
+/* Parses the lines of a chunk, stores its data and defines its labels. The chunk stops at the first problem */
+static void *size_chunk(void *arg) {
+    Chunk *chunk = (Chunk *) arg;
+    char *line, *end;
+    Statement statement;
+
+    if (memchr(chunk->start, '\0', (size_t) (chunk->end - chunk->start))) {
+        chunk->failed = TRUE;       /* the lines couldn't be restored */
+        return NULL;
+    }
+
+    chunk->terminated = TRUE;
+    for (line = chunk->start; line < chunk->end && !chunk->failed; line = end + 1) {
+        if ((end = (char *) memchr(line, '\n', (size_t) (chunk->end - line))))
+            *end = '\0';
+        else
+            end = chunk->end;       /* the last line of the source, which is already terminated */
+        chunk->lines++;
+
+        if ((chunk->max_line_length && (unsigned int) (end - line) > chunk->max_line_length) ||
+            lex_statement(line, chunk->lines, &statement))
+            chunk->failed = TRUE;
+        else
+            size_statement(chunk, &statement);
+    }
+
+    return NULL;
+}
+
+
+/* Like the serial first pass of a statement, with the counters and the symbols of the chunk */
+static void size_statement(Chunk *chunk, stmtptr statement) {
+    char *label = NULL;
+    unsigned int data_offset;
+
+    if (statement->label.length)
+        label = arena_strndup(chunk->arena, statement->label.start, statement->label.length);
+
+    if (statement->kind == OPERATION_STATEMENT) {
+        if (label)
+            define_label(chunk, label, chunk->instruction_counter, CODE_SYMBOL);
+        chunk->instruction_counter += (unsigned int) get_instruction_length(statement);
+        add_statement(chunk->statements, statement);
+
+    } else if (is_data_statement(statement->directive)) {
+        data_offset = chunk->data_memory->length;
+        if (!store_data(statement, chunk->data_memory))
+            chunk->failed = TRUE;
+        else if (label)
+            define_label(chunk, label, data_offset, DATA_SYMBOL);
+
+    } else if (statement->directive == EXTERN || statement->directive == ENTRY) {
+        if (label)                  /* a warning */
+            chunk->failed = TRUE;
+        else if (statement->directive == EXTERN)
+            define_label(chunk, arena_strndup(chunk->arena, statement->dst.text.start, statement->dst.text.length),
+                         0, EXTERN_SYMBOL);
+        else
+            add_statement(chunk->statements, statement);
+    }
+}
+
+
+/* Adds a label to the symbols of a chunk. A label which can't be added fails the chunk */
+static void define_label(Chunk *chunk, char *name, unsigned int value, SymbolType type) {
+    if (!add_symbol(chunk->symbols_table, new_symbol(name, value, type, chunk->arena)))
+        chunk->failed = TRUE;
+}
+
+
+/* Encodes the operations of a chunk into its part of the instruction memory */
+static void *encode_chunk(void *arg) {
+    Chunk *chunk = (Chunk *) arg;
+    Statement *statement, *end = chunk->statements->list + chunk->statements->count;
+
+    for (statement = chunk->statements->list; statement < end; statement++) {
+        if (statement->kind == OPERATION_STATEMENT)
+            store_instruction(statement, &chunk->code, &chunk->view, NULL);
+    }
+
+    return NULL;
+}
@@ -0,0 +1,73 @@
+#ifndef PROJECT_CHUNKS_H
+#define PROJECT_CHUNKS_H
+
+#include "source.h"
+#include "memory.h"
+
+
+#define MIN_CHUNK_SIZE (64UL * 1024)   /* Smaller blocks of a source aren't worth a thread of their own */
+
+
+/* A block of whole lines of a source, which is sized and encoded by a thread of its own */
+typedef struct chunk {
+    char *start;                    /* First character of the chunk */
+    char *end;                      /* After the last character of the chunk */
+    unsigned int lines;             /* Number of lines in the chunk */
+    unsigned int max_line_length;   /* Longer lines are errors, 0 for no limit */
+    unsigned int instruction_counter; /* Number of code words in the chunk */
+    unsigned int code_address;      /* Address of the first code word, set by the prefix sum of the chunks */
+    unsigned int data_offset;       /* Index of the first data word in the data of the source */
+    stlptr statements;              /* The operations and the entries, which are kept for encoding */
+    tptr symbols_table;             /* The labels of the chunk, their values are counted from the chunk */
+    segptr data_memory;             /* The data words of the chunk */
+    Segment code;                   /* The part of the instruction memory where the chunk is encoded */
+    SymbolsTable view;              /* A copy of the merged table, which counts the searches of the chunk */
+    int terminated;                 /* The lines of the chunk were terminated in place */
+    int failed;                     /* The chunk has an error or a warning, which is left to the serial passes */
+    aptr arena;                     /* The chunk allocates from an arena of its own */
+} Chunk;
+
+
+/* A source split into chunks */
+typedef struct chunks *chkptr;
+typedef struct chunks {
+    Chunk *list;
+    int count;                      /* Number of chunks in the list */
+    unsigned int address;           /* Address of the first instruction */
+    unsigned int code_length;       /* Number of code words of all the chunks */
+    unsigned int data_length;       /* Number of data words of all the chunks */
+    unsigned int lines;             /* Number of lines of all the chunks */
+    unsigned long allocations;      /* Allocations of the chunk arenas, for the statistics */
+    size_t allocated;               /* Bytes allocated by the chunk arenas, for the statistics */
+} Chunks;
+
+
+/* Splits a source into at most 'threads' chunks of whole lines.
+ * Returns 1 on success, or 0 if the source is too small to be split */
+int split_source(chkptr chunks, srcptr source, int threads, unsigned int address, aptr arena);
+
+
+/* Parses the lines of every chunk and counts its words on a thread of its own - the first pass of the chunks.
+ * Returns 1 on success, or 0 if a chunk has an error or a warning, which are reported by the serial passes */
+int size_chunks(chkptr chunks, unsigned int max_line_length, aptr arena);
+
+
+/* Places the chunks by a prefix sum of their counters, and merges their symbols and their data in order.
+ * Returns the merged symbols table, or NULL if a label is defined twice or an external is an entry */
+tptr merge_chunks(chkptr chunks, segptr data_memory, aptr arena);
+
+
+/* Encodes the instructions of every chunk on a thread of its own, against the merged symbols table,
+ * and marks the entries - the second pass of the chunks. Returns the instruction memory */
+segptr encode_chunks(chkptr chunks, tptr symbols_table, aptr arena);
+
+
+/* Restores the lines which were terminated in place, so the serial passes can read the source again */
+void restore_source(chkptr chunks);
+
+
+/* Frees the memory of the chunks */
+void delete_chunks(chkptr chunks);
+
+
+#endif
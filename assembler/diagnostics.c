@@ -0,0 +1,204 @@
+/* This file is implementing the diagnostics of the assembler.
+ * Errors are collected in memory while a file is assembled,
+ * and printed by the order of their lines at the end of every pass, as text or as JSON lines. */
+
+#include <stdio.h>
+#include <string.h>
+#include "diagnostics.h"
+
+
+#define INITIAL_DIAGNOSTICS 16
+
+enum {
+    FALSE, TRUE
+};
+
+
+static void sort_diagnostics(dptr diagnostics);
+
+static void print_json_string(FILE *out, const char *str);
+
+
+/* Initialize an empty collection of diagnostics */
+void init_diagnostics(dptr diagnostics, unsigned int max_errors, aptr arena) {
+    diagnostics->list = NULL;
+    diagnostics->count = 0;
+    diagnostics->capacity = 0;
+    diagnostics->printed = 0;
+    diagnostics->max_errors = max_errors;
+    diagnostics->arena = arena;
+}
+
+
+/* Records an error. Returns 0 if the limit of errors was reached, else returns 1 */
+int add_diagnostic(dptr diagnostics, unsigned int line, unsigned int column, ErrorCode code) {
+    Diagnostic *new;
+
+    if (too_many_errors(diagnostics))
+        return FALSE;
+
+    if (diagnostics->count == diagnostics->capacity) {
+        unsigned int capacity = diagnostics->capacity ? diagnostics->capacity * 2 : INITIAL_DIAGNOSTICS;
+        diagnostics->list = (Diagnostic *) arena_grow(diagnostics->arena, diagnostics->list,
+                                                      diagnostics->capacity * sizeof(Diagnostic),
+                                                      capacity * sizeof(Diagnostic));
+        diagnostics->capacity = capacity;
+    }
+
+    new = &diagnostics->list[diagnostics->count++];
+    new->line = line;
+    new->column = column;
+    new->code = code;
+    new->message = get_error_message(code);
+
+    return !too_many_errors(diagnostics);
+}
+
+
+/* Checks if the limit of errors was reached */
+int too_many_errors(dptr diagnostics) {
+    return (diagnostics->max_errors && diagnostics->count >= diagnostics->max_errors);
+}
+
+
+/* Prints the errors that weren't printed yet, by the order of their lines. Returns the number of errors printed.
+ * If 'out' is NULL the errors are only counted, and kept in the list */
+int print_diagnostics(dptr diagnostics, FILE *out, char *file_name, DiagnosticsFormat format) {
+    Diagnostic *current;
+    int count = 0;
+
+    sort_diagnostics(diagnostics);
+    if (!out) {
+        count = (int) (diagnostics->count - diagnostics->printed);
+        diagnostics->printed = diagnostics->count;
+        return count;
+    }
+
+    for (; diagnostics->printed < diagnostics->count; diagnostics->printed++, count++) {
+        current = &diagnostics->list[diagnostics->printed];
+        if (format == JSON_FORMAT) {
+            fprintf(out, "{\"file\":");
+            print_json_string(out, file_name);
+            fprintf(out, ",\"line\":%u,\"column\":%u,\"code\":\"%s\",\"message\":", current->line, current->column,
+                    get_error_name(current->code));
+            print_json_string(out, current->message);
+            fprintf(out, "}\n");
+        } else
+            fprintf(out, "ERROR: in line %u - %s\n", current->line, current->message);
+    }
+
+    if (count && too_many_errors(diagnostics)) {
+        if (format == JSON_FORMAT) {
+            fprintf(out, "{\"file\":");
+            print_json_string(out, file_name);
+            fprintf(out, ",\"code\":\"too-many-errors\",\"message\":\"stopped after %u errors.\"}\n",
+                    diagnostics->count);
+        } else
+            fprintf(out, "ERROR: too many errors - stopped after %u errors.\n", diagnostics->count);
+    }
+
+    return count;
+}
+
+
+/* Returns the message of an error */
+const char *get_error_message(ErrorCode code) {
+    switch (code) {
+        case INVALID_STATEMENT:
+            return "invalid statement.";
+        case INVALID_DATA:
+            return "invalid data.";
+        case INVALID_LABEL:
+        case KEYWORD_LABEL:
+        case DUPLICATE_LABEL:
+            return "invalid label name.";
+        case LINE_TOO_LONG:
+            return "line is too long.";
+        case INVALID_MACRO:
+            return "invalid macro definition.";
+        case KEYWORD_MACRO:
+            return "invalid macro name.";
+        case DUPLICATE_MACRO:
+            return "macro name already defined.";
+        case UNTERMINATED_MACRO:
+            return "macro definition without 'endmcro'.";
+    }
+    return "unknown error.";
+}
+
+
+/* Returns the name of an error, as used by the JSON format */
+const char *get_error_name(ErrorCode code) {
+    switch (code) {
+        case INVALID_STATEMENT:
+            return "invalid-statement";
+        case INVALID_DATA:
+            return "invalid-data";
+        case INVALID_LABEL:
+            return "invalid-label";
+        case KEYWORD_LABEL:
+            return "keyword-label";
+        case DUPLICATE_LABEL:
+            return "duplicate-label";
+        case LINE_TOO_LONG:
+            return "line-too-long";
+        case INVALID_MACRO:
+            return "invalid-macro";
+        case KEYWORD_MACRO:
+            return "keyword-macro";
+        case DUPLICATE_MACRO:
+            return "duplicate-macro";
+        case UNTERMINATED_MACRO:
+            return "unterminated-macro";
+    }
+    return "unknown";
+}
+
+
+/* Sorts the errors that weren't printed yet by their lines, keeping the order of the errors of every line.
+ * The errors of the macros and of a pass are each in order, so they are merged by a stable merge sort */
+static void sort_diagnostics(dptr diagnostics) {
+    Diagnostic *list = diagnostics->list + diagnostics->printed, *from, *to, *swap;
+    unsigned int count = diagnostics->count - diagnostics->printed, width, start, middle, end, left, right, i;
+
+    for (i = 1; i < count && list[i - 1].line <= list[i].line; i++)
+        ;
+    if (i >= count)                 /* usually they are already in order */
+        return;
+
+    from = list;
+    to = (Diagnostic *) arena_alloc(diagnostics->arena, count * sizeof(Diagnostic));
+    for (width = 1; width < count; width *= 2) {
+        for (start = 0; start < count; start = end) {
+            middle = (start + width < count) ? start + width : count;
+            end = (middle + width < count) ? middle + width : count;
+            for (left = start, right = middle, i = start; i < end; i++) {
+                if (left < middle && (right == end || from[left].line <= from[right].line))
+                    to[i] = from[left++];
+                else
+                    to[i] = from[right++];
+            }
+        }
+        swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != list)
+        memcpy(list, from, count * sizeof(Diagnostic));
+}
+
+
+/* Prints a string as a quoted JSON string */
+static void print_json_string(FILE *out, const char *str) {
+    putc('"', out);
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            fprintf(out, "\\%c", *str);
+        else if ((unsigned char) *str < ' ')
+            fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *str);
+        else
+            putc(*str, out);
+    }
+    putc('"', out);
+}
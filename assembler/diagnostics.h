@@ -0,0 +1,67 @@
+#ifndef PROJECT_DIAGNOSTICS_H
+#define PROJECT_DIAGNOSTICS_H
+
+#include <stdio.h>
+#include "arena.h"
+
+
+/* Supported errors */
+typedef enum error_code {
+    INVALID_STATEMENT = 1, INVALID_DATA, INVALID_LABEL, KEYWORD_LABEL, DUPLICATE_LABEL, LINE_TOO_LONG,
+    INVALID_MACRO, KEYWORD_MACRO, DUPLICATE_MACRO, UNTERMINATED_MACRO
+} ErrorCode;
+
+
+/* Supported output formats of the diagnostics */
+typedef enum diagnostics_format {
+    TEXT_FORMAT, JSON_FORMAT
+} DiagnosticsFormat;
+
+
+/* A single error found in a source file */
+typedef struct diagnostic {
+    unsigned int line;
+    unsigned int column;            /* Counted from 1, 0 if the error isn't related to a specific column */
+    ErrorCode code;
+    const char *message;
+} Diagnostic;
+
+
+/* The errors of a source file */
+typedef struct diagnostics *dptr;
+typedef struct diagnostics {
+    Diagnostic *list;
+    unsigned int count;             /* Number of errors collected */
+    unsigned int capacity;          /* Number of allocated errors */
+    unsigned int printed;           /* Number of errors already printed */
+    unsigned int max_errors;        /* The collecting stops after this many errors, 0 for no limit */
+    aptr arena;                     /* The errors are allocated from this arena */
+} Diagnostics;
+
+
+/* Initialize an empty collection of diagnostics */
+void init_diagnostics(dptr diagnostics, unsigned int max_errors, aptr arena);
+
+
+/* Records an error. Returns 0 if the limit of errors was reached, else returns 1 */
+int add_diagnostic(dptr diagnostics, unsigned int line, unsigned int column, ErrorCode code);
+
+
+/* Checks if the limit of errors was reached */
+int too_many_errors(dptr diagnostics);
+
+
+/* Prints the errors that weren't printed yet, by the order of their lines. Returns the number of errors printed.
+ * If 'out' is NULL the errors are only counted, and kept in the list */
+int print_diagnostics(dptr diagnostics, FILE *out, char *file_name, DiagnosticsFormat format);
+
+
+/* Returns the message of an error */
+const char *get_error_message(ErrorCode code);
+
+
+/* Returns the name of an error, as used by the JSON format */
+const char *get_error_name(ErrorCode code);
+
+
+#endif
@@ -0,0 +1,326 @@
+/* This file is implementing the disassembler, which prints the source of an .ob file with the address of every line.
+ * The file is read once in blocks - every pair of base-64 characters is decoded through a table, and the fields of
+ * the words are split by their masks, so an image of any size is printed in a single pass.
+ * The names of the entries and of the externals are restored from the .ent and .ext files when they exist,
+ * and a label which isn't an entry is printed as 'L' and its address. Such a label is also defined at its line
+ * when it's used before the line, like the labels of the data, so the printed source can be assembled again. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assemble.h"
+#include "module.h"
+
+
+#define BLOCK_SIZE 65536
+#define EXTENSION_LENGTH 4          /* The longest extension of an object file */
+#define OPERAND_LENGTH (MAX_LABEL_LENGTH + 1)
+#define OPCODE_MASK 0xF
+#define TYPE_MASK 0x7
+#define REGISTER_MASK 0x1F
+#define ADDRESS_MASK (WORD_MASK >> OPERAND_SHIFT)
+#define OPERAND_SIGN_BIT (1 << (WORD_LENGTH - OPERAND_SHIFT - 1))
+#define WORD_SIGN_BIT (1 << (WORD_LENGTH - 1))
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* The .ob file, read in blocks */
+typedef struct reader {
+    FILE *fd;
+    unsigned char data[BLOCK_SIZE];
+    size_t position;                /* Next character to read */
+    size_t length;                  /* Number of characters in the block */
+} Reader;
+
+
+/* The state of a disassembled file */
+typedef struct disassembly *disptr;
+typedef struct disassembly {
+    char *file_name;
+    Reader input;
+    ModuleSymbol *entries;          /* Sorted by their addresses */
+    unsigned int entries_count;
+    unsigned int next_entry;        /* The first entry which wasn't printed as a label */
+    ModuleSymbol *externals;        /* Sorted by the addresses of the words which use them */
+    unsigned int externals_count;
+    unsigned int next_external;     /* The first use of an external which wasn't printed */
+    unsigned char used[ADDRESS_MASK + 1];   /* The addresses used by the printed operands */
+} Disassembly;
+
+
+/* The names of the operations, by their codes */
+static const char *operation_names[TOTAL_OPERATIONS] = {
+    "mov", "cmp", "add", "sub", "not", "clr", "lea", "inc", "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "stop"
+};
+
+
+static int disassemble(disptr job);
+
+static unsigned int print_instruction(disptr job, uint16_t *words, unsigned int count, unsigned int address);
+
+static void format_operand(disptr job, char *text, unsigned int type, unsigned int word, int register_shift,
+                           unsigned int address);
+
+static void print_data(disptr job, uint16_t word, unsigned int address, const char *comment);
+
+static const char *get_label(disptr job, unsigned int address);
+
+static const char *find_entry(disptr job, unsigned int address);
+
+static int read_word(Reader *input, uint16_t *word);
+
+static int read_number(Reader *input, unsigned int *number);
+
+static int next_character(Reader *input);
+
+static int compare_symbols(const void *first, const void *second);
+
+static int disassembly_error(disptr job, const char *problem);
+
+
+int main(int argc, char *argv[]) {
+    static Disassembly job;         /* holds the blocks of the file */
+    char *name;
+    size_t length;
+    int result;
+    aptr arena;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s program\n", argv[0]);
+        return 1;
+    }
+
+    arena = new_arena();
+    length = strlen(argv[1]);
+    if (length > strlen(TEXT_OBJECT_EXTENSION) &&
+        !strcmp(argv[1] + length - strlen(TEXT_OBJECT_EXTENSION), TEXT_OBJECT_EXTENSION))
+        length -= strlen(TEXT_OBJECT_EXTENSION);
+    name = (char *) arena_alloc(arena, length + EXTENSION_LENGTH + 1);
+    memcpy(name, argv[1], length);
+
+    /* the symbols are read first, the words are printed as they are read */
+    strcpy(name + length, ".ent");
+    if (!read_module_symbols(name, &job.entries, &job.entries_count, arena))
+        fprintf(stderr, "WARNING: invalid entries file '%s' - the entries are printed by their addresses.\n", name);
+    strcpy(name + length, ".ext");
+    if (!read_module_symbols(name, &job.externals, &job.externals_count, arena))
+        fprintf(stderr, "WARNING: invalid externals file '%s' - the externals are printed by their addresses.\n",
+                name);
+    if (job.entries_count)
+        qsort(job.entries, job.entries_count, sizeof(ModuleSymbol), compare_symbols);
+    if (job.externals_count)
+        qsort(job.externals, job.externals_count, sizeof(ModuleSymbol), compare_symbols);
+
+    strcpy(name + length, TEXT_OBJECT_EXTENSION);
+    job.file_name = name;
+    if (!(job.input.fd = fopen(name, "rb"))) {
+        fprintf(stderr, "*** ERROR: failed to open '%s' *** \n", name);
+        delete_arena(arena);
+        return 1;
+    }
+
+    setvbuf(stdout, NULL, _IOFBF, BLOCK_SIZE);
+    result = disassemble(&job);
+    fclose(job.input.fd);
+    delete_arena(arena);
+
+    return result ? 0 : 1;
+}
+
+
+/* Prints the instructions of the code words and then the data words. Returns 1 on success, else returns 0 */
+static int disassemble(disptr job) {
+    uint16_t words[MAX_INSTRUCTION_LENGTH];
+    unsigned int code_length, data_length, filled = 0, length, address = DEFAULT_ADDRESS, i;
+    int status;
+
+    if (!read_number(&job->input, &code_length) || !read_number(&job->input, &data_length))
+        return disassembly_error(job, "missing the counts of the words");
+
+    /* a window of the words of the next instruction, which is refilled after every instruction */
+    for (i = 0; i < code_length; i += length, address += length) {
+        while (filled < MAX_INSTRUCTION_LENGTH && i + filled < code_length) {
+            if ((status = read_word(&job->input, &words[filled++])) <= 0)
+                return disassembly_error(job, status ? "invalid word" : "fewer words than counted");
+        }
+        length = print_instruction(job, words, filled, address);
+        filled -= length;
+        memmove(words, words + length, filled * sizeof(uint16_t));
+    }
+
+    for (i = 0; i < data_length; i++, address++) {
+        if ((status = read_word(&job->input, &words[0])) <= 0)
+            return disassembly_error(job, status ? "invalid word" : "fewer words than counted");
+        print_data(job, words[0], address, "");
+    }
+
+    if (read_word(&job->input, &words[0]))
+        return disassembly_error(job, "more words than counted");
+
+    return TRUE;
+}
+
+
+/* Prints the instruction which starts at the first of 'count' words. A word which doesn't start a valid instruction
+ * is printed as data. Returns the number of words printed */
+static unsigned int print_instruction(disptr job, uint16_t *words, unsigned int count, unsigned int address) {
+    unsigned int operation = (words[0] >> OPCODE_SHIFT) & OPCODE_MASK, length;
+    unsigned int src = (words[0] >> SRC_TYPE_SHIFT) & TYPE_MASK, dst = (words[0] >> DST_TYPE_SHIFT) & TYPE_MASK;
+    char source[OPERAND_LENGTH], destination[OPERAND_LENGTH];
+    const char *label;
+
+    length = 1 + (dst != 0) + (src != 0 && !(src == REGISTER_DIRECT && dst == REGISTER_DIRECT));
+    if ((words[0] & ENCTYPE_MASK) != ABSOLUTE || (src && !dst) || length > count ||
+        (src != 0) + (dst != 0) != get_number_of_operands((Operation) operation) ||
+        (src && src != IMMEDIATE && src != DIRECT && src != REGISTER_DIRECT) ||
+        (dst && dst != IMMEDIATE && dst != DIRECT && dst != REGISTER_DIRECT)) {
+        print_data(job, words[0], address, "\t; not an instruction");
+        return 1;
+    }
+
+    label = get_label(job, address);
+    if (!dst)
+        printf("%04u\t%s\t%s\n", address, label, operation_names[operation]);
+    else if (!src) {                    /* the only operand is encoded in the word of a source operand */
+        format_operand(job, destination, dst, words[1], SRC_REG_SHIFT, address + 1);
+        printf("%04u\t%s\t%s %s\n", address, label, operation_names[operation], destination);
+    } else {
+        format_operand(job, source, src, words[1], SRC_REG_SHIFT, address + 1);
+        if (length == 2)                /* two registers share a word */
+            format_operand(job, destination, dst, words[1], DST_REG_SHIFT, address + 1);
+        else
+            format_operand(job, destination, dst, words[2], DST_REG_SHIFT, address + 2);
+        printf("%04u\t%s\t%s %s,%s\n", address, label, operation_names[operation], source, destination);
+    }
+
+    return length;
+}
+
+
+/* Formats an operand word which is found at 'address' */
+static void format_operand(disptr job, char *text, unsigned int type, unsigned int word, int register_shift,
+                           unsigned int address) {
+    unsigned int operand = (word >> OPERAND_SHIFT) & ADDRESS_MASK;
+    const char *name;
+
+    if (type == REGISTER_DIRECT)
+        sprintf(text, "@r%u", (word >> register_shift) & REGISTER_MASK);
+    else if (type == IMMEDIATE)
+        sprintf(text, "%d", (operand & OPERAND_SIGN_BIT) ? (int) operand - (int) (ADDRESS_MASK + 1) : (int) operand);
+    else if ((word & ENCTYPE_MASK) == EXTERNAL) {
+        while (job->next_external < job->externals_count && job->externals[job->next_external].address < address)
+            job->next_external++;
+        if (job->next_external < job->externals_count && job->externals[job->next_external].address == address)
+            sprintf(text, "%.*s", MAX_LABEL_LENGTH, job->externals[job->next_external].name);
+        else
+            sprintf(text, "EXTERNAL");      /* the .ext file is missing */
+    } else if ((name = find_entry(job, operand)))
+        sprintf(text, "%.*s", MAX_LABEL_LENGTH, name);
+    else {
+        sprintf(text, "L%u", operand);
+        job->used[operand] = TRUE;
+    }
+}
+
+
+/* Prints a data word as a signed number */
+static void print_data(disptr job, uint16_t word, unsigned int address, const char *comment) {
+    int value = (word & WORD_SIGN_BIT) ? (int) word - (WORD_MASK + 1) : (int) word;
+
+    printf("%04u\t%s\t.data %d%s\n", address, get_label(job, address), value, comment);
+}
+
+
+/* Returns the label of a line - the name of the entry at its address, 'L' and its address if an operand which was
+ * printed before uses it, or an empty label */
+static const char *get_label(disptr job, unsigned int address) {
+    static char label[MAX_LABEL_LENGTH + 2];    /* the name and ':' */
+
+    while (job->next_entry < job->entries_count && job->entries[job->next_entry].address < address)
+        job->next_entry++;
+    if (job->next_entry < job->entries_count && job->entries[job->next_entry].address == address) {
+        sprintf(label, "%.*s:", MAX_LABEL_LENGTH, job->entries[job->next_entry].name);
+        return label;
+    }
+    if (address <= ADDRESS_MASK && job->used[address]) {
+        sprintf(label, "L%u:", address);
+        return label;
+    }
+
+    return "";
+}
+
+
+/* Returns the name of the entry at an address, or NULL if there's none */
+static const char *find_entry(disptr job, unsigned int address) {
+    ModuleSymbol key, *found;
+
+    if (!job->entries_count)
+        return NULL;
+
+    key.name = NULL;
+    key.address = address;
+    found = (ModuleSymbol *) bsearch(&key, job->entries, job->entries_count, sizeof(ModuleSymbol), compare_symbols);
+
+    return found ? found->name : NULL;
+}
+
+
+/* Reads the next word - 2 base-64 characters, after any white space. Returns 1 on success, 0 at the end of the file,
+ * or -1 on an invalid word */
+static int read_word(Reader *input, uint16_t *word) {
+    int c, high, low;
+
+    while ((c = next_character(input)) == ' ' || c == '\n' || c == '\r' || c == '\t');
+    if (c == EOF)
+        return 0;
+
+    if ((high = decode_base64(c)) < 0 || (c = next_character(input)) == EOF || (low = decode_base64(c)) < 0)
+        return -1;
+    *word = (uint16_t) ((high << 6) | low);
+
+    return 1;
+}
+
+
+/* Reads an unsigned number of the header line, after any white space. Returns 1 on success, else returns 0 */
+static int read_number(Reader *input, unsigned int *number) {
+    int c, digits = 0;
+
+    while ((c = next_character(input)) == ' ' || c == '\t');
+    for (*number = 0; c >= '0' && c <= '9'; c = next_character(input), digits++)
+        *number = *number * 10 + (unsigned int) (c - '0');
+
+    return digits > 0 && (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+}
+
+
+/* Returns the next character of the file, or EOF at its end. The file is read a block at a time */
+static int next_character(Reader *input) {
+    if (input->position == input->length) {
+        input->position = 0;
+        if (!(input->length = fread(input->data, 1, BLOCK_SIZE, input->fd)))
+            return EOF;
+    }
+
+    return input->data[input->position++];
+}
+
+
+/* Compares symbols by their addresses, for sorting and searching */
+static int compare_symbols(const void *first, const void *second) {
+    unsigned int a = ((const ModuleSymbol *) first)->address, b = ((const ModuleSymbol *) second)->address;
+
+    return (a > b) - (a < b);
+}
+
+
+/* A file which can't be disassembled */
+static int disassembly_error(disptr job, const char *problem) {
+    fflush(stdout);
+    fprintf(stderr, "*** ERROR: '%s' - %s *** \n", job->file_name, problem);
+    return FALSE;
+}
@@ -0,0 +1,122 @@
+/* This file is implementing the command line of the emulator, which runs an assembled program.
+ * The exit code tells how the program ended, so tests can run programs and check them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "assemble.h"
+#include "machine.h"
+
+
+/* Exit codes of the emulator */
+enum {
+    EXIT_STOPPED, EXIT_FAULT, EXIT_LIMIT
+};
+
+enum {
+    FALSE, TRUE
+};
+
+
+static int parse_options(int argc, char *argv[], unsigned long *limit, int *summary);
+
+static void print_summary(machptr machine, double seconds);
+
+static int machine_error(char *program, machptr machine, const char *problem);
+
+
+int main(int argc, char *argv[]) {
+    int i, summary, result;
+    unsigned long limit;
+    clock_t start;
+    Module module;
+    MachineState state;
+    machptr machine;
+    aptr arena;
+
+    if ((i = parse_options(argc, argv, &limit, &summary)) < 0 || i != argc - 1) {
+        fprintf(stderr, "Usage: %s [--limit instructions] [--summary] program\n", argv[0]);
+        return EXIT_FAULT;
+    }
+
+    arena = new_arena();
+    if (!read_module(&module, argv[i], DEFAULT_ADDRESS, arena)) {
+        delete_arena(arena);
+        return EXIT_FAULT;
+    }
+    if (module.externals_count) {
+        fprintf(stderr, "*** ERROR: '%s' uses externals - it has to be linked first *** \n", argv[i]);
+        delete_arena(arena);
+        return EXIT_FAULT;
+    }
+
+    machine = new_machine(&module, stdin, stdout, arena);
+    start = clock();
+    state = run_machine(machine, limit);
+    if (summary)
+        print_summary(machine, (double) (clock() - start) / CLOCKS_PER_SEC);
+
+    if (state == STOPPED)
+        result = EXIT_STOPPED;
+    else if (state == LIMIT_REACHED) {
+        machine_error(argv[i], machine, "reached the limit of instructions");
+        result = EXIT_LIMIT;
+    }
+    else if (state == INVALID_INSTRUCTION)
+        result = machine_error(argv[i], machine, "invalid instruction");
+    else if (state == STACK_OVERFLOW)
+        result = machine_error(argv[i], machine, "too many nested 'jsr' calls");
+    else
+        result = machine_error(argv[i], machine, "'rts' without a 'jsr' call");
+
+    delete_arena(arena);
+
+    return result;
+}
+
+
+/* Reads the options from the command line. Returns the index of the program, or -1 on invalid options */
+static int parse_options(int argc, char *argv[], unsigned long *limit, int *summary) {
+    int i;
+    char *value;
+
+    *limit = 0;
+    *summary = FALSE;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (!strcmp(argv[i], "--limit")) {
+            if (!(value = argv[++i]) || atol(value) < 1)
+                return -1;
+            *limit = (unsigned long) atol(value);
+        } else if (!strcmp(argv[i], "--summary")) {
+            *summary = TRUE;
+        } else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i;
+}
+
+
+/* Prints the number of executed instructions, their speed and the registers to the standard error */
+static void print_summary(machptr machine, double seconds) {
+    int i;
+
+    fprintf(stderr, "Executed %lu instructions in %.3f seconds", machine->executed, seconds);
+    if (seconds > 0)
+        fprintf(stderr, " (%.1f million per second)", (double) machine->executed / seconds / 1e6);
+    fprintf(stderr, ".\n");
+
+    for (i = 0; i < REGISTERS; i++)
+        fprintf(stderr, "@r%d=%u%s", i, machine->registers[i], (i < REGISTERS - 1) ? " " : "\n");
+}
+
+
+/* A program which didn't stop */
+static int machine_error(char *program, machptr machine, const char *problem) {
+    fprintf(stderr, "*** ERROR: '%s' - %s at address %u *** \n", program, problem, machine->pc);
+    return EXIT_FAULT;
+}
@@ -0,0 +1,273 @@
+/*
+ *  This file is a generator of large assembly programs, used by the benchmark.
+ *  The program is printed to the standard output.
+ *
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define PERCENT 100
+#define REGISTERS 8
+#define MAX_IMMEDIATE 511           /* Largest number that fits in an operand word */
+#define MAX_DATA 2047               /* Largest number that fits in a data word */
+#define STRING_LENGTH 12
+#define TOTAL_ERRORS 4
+
+enum {
+    NONE, IMMEDIATE, DIRECT, REGISTER_DIRECT
+};
+
+
+/* Options of the generator */
+typedef struct generator *genptr;
+typedef struct generator {
+    unsigned long lines;            /* Number of lines in the program */
+    unsigned long labels;           /* Number of labels defined in the program, at least 1 */
+    unsigned long data_size;        /* Number of values in a '.data' statement */
+    int data;                       /* Percent of the statements which are data */
+    int externs;                    /* Number of externals, in percent of the labels */
+    int entries;                    /* Percent of the labels which are entries */
+    int errors;                     /* Percent of the statements which are invalid */
+    int comments;                   /* Percent of the lines which are comments or empty */
+    unsigned int seed;
+} Generator;
+
+
+/* An operation and the addressing types it accepts */
+typedef struct operation {
+    char *name;
+    int operands;
+    int src_types;                  /* Bit 'n' is set if addressing type 'n' is accepted */
+    int dst_types;
+} Operation;
+
+
+static void generate(genptr options);
+
+static void print_statement(genptr options, unsigned long externs);
+
+static void print_operation(genptr options, unsigned long externs);
+
+static void print_data(genptr options);
+
+static void print_operand(genptr options, int types, unsigned long externs);
+
+static void print_label_name(genptr options, unsigned long externs);
+
+static unsigned long random_number(unsigned long limit);
+
+static int parse_options(int argc, char *argv[], genptr options);
+
+
+#define ANY ((1 << IMMEDIATE) | (1 << DIRECT) | (1 << REGISTER_DIRECT))
+#define WRITABLE ((1 << DIRECT) | (1 << REGISTER_DIRECT))
+#define LABEL (1 << DIRECT)
+
+static Operation operations[] = {
+    {"mov",  2, ANY,   WRITABLE},
+    {"cmp",  2, ANY,   ANY},
+    {"add",  2, ANY,   WRITABLE},
+    {"sub",  2, ANY,   WRITABLE},
+    {"not",  1, NONE,  WRITABLE},
+    {"clr",  1, NONE,  WRITABLE},
+    {"lea",  2, LABEL, WRITABLE},
+    {"inc",  1, NONE,  WRITABLE},
+    {"dec",  1, NONE,  WRITABLE},
+    {"jmp",  1, NONE,  WRITABLE},
+    {"bne",  1, NONE,  WRITABLE},
+    {"red",  1, NONE,  WRITABLE},
+    {"prn",  1, NONE,  ANY},
+    {"jsr",  1, NONE,  WRITABLE},
+    {"rts",  0, NONE,  NONE},
+    {"stop", 0, NONE,  NONE}
+};
+
+static char *invalid_statements[] = {"mov @r9, @r1", "foo X", "cmp 5,", ".data 3,,4"};
+
+
+int main(int argc, char *argv[]) {
+    Generator options;
+
+    if (parse_options(argc, argv, &options) < 0) {
+        fprintf(stderr, "Usage: %s lines [--labels count] [--data percent] [--data-size count] "
+                        "[--externs percent] [--entries percent] [--errors percent] [--comments percent] "
+                        "[--seed seed]\n", argv[0]);
+        return 1;
+    }
+
+    generate(&options);
+
+    return 0;
+}
+
+
+/* Prints a program - the externals first, then the statements, then the entries */
+static void generate(genptr options) {
+    unsigned long i, line, step, next_label = 0;
+    unsigned long externs = options->labels * options->externs / PERCENT;
+    unsigned long entries = options->labels * options->entries / PERCENT;
+    unsigned long body = options->lines > externs + entries ? options->lines - externs - entries : 1;
+    int label_line;
+
+    if (options->labels > body)
+        options->labels = body;
+    step = body / options->labels;          /* the labels are spread evenly over the statements */
+
+    srand(options->seed);
+
+    for (i = 0; i < externs; i++)
+        printf(".extern X%lu\n", i);
+
+    for (line = 0; line < body; line++) {
+        label_line = (next_label < options->labels && line >= next_label * step);
+        if (!label_line && (int) random_number(PERCENT) < options->comments) {
+            printf(line % 2 ? "; generated comment\n" : "\n");
+            continue;
+        }
+
+        if (label_line)
+            printf("L%lu:\t", next_label++);
+        else
+            putchar('\t');
+        print_statement(options, externs);
+    }
+
+    for (i = 0; i < entries; i++)       /* spread over all the labels */
+        printf(".entry L%lu\n", i * (options->labels / (entries ? entries : 1)));
+}
+
+
+/* Prints a single statement, which is either an operation, data or an error */
+static void print_statement(genptr options, unsigned long externs) {
+    if ((int) random_number(PERCENT) < options->errors)
+        printf("%s\n", invalid_statements[random_number(TOTAL_ERRORS)]);
+    else if ((int) random_number(PERCENT) < options->data)
+        print_data(options);
+    else
+        print_operation(options, externs);
+}
+
+
+/* Prints an operation with operands of the addressing types it accepts */
+static void print_operation(genptr options, unsigned long externs) {
+    Operation *operation = &operations[random_number(sizeof(operations) / sizeof(Operation))];
+
+    printf("%s", operation->name);
+    if (operation->operands == 2) {
+        putchar(' ');
+        print_operand(options, operation->src_types, externs);
+        putchar(',');
+    }
+    if (operation->operands) {
+        putchar(' ');
+        print_operand(options, operation->dst_types, externs);
+    }
+    putchar('\n');
+}
+
+
+/* Prints a '.data' statement, or sometimes a '.string' statement */
+static void print_data(genptr options) {
+    unsigned long i;
+
+    if (!random_number(4)) {
+        printf(".string \"");
+        for (i = 0; i < STRING_LENGTH; i++)
+            putchar('a' + (int) random_number(26));
+        printf("\"\n");
+        return;
+    }
+
+    printf(".data ");
+    for (i = 0; i < options->data_size; i++)
+        printf(i ? ", %ld" : "%ld", (long) random_number(2 * MAX_DATA + 1) - MAX_DATA);
+    putchar('\n');
+}
+
+
+/* Prints an operand of one of the given addressing types */
+static void print_operand(genptr options, int types, unsigned long externs) {
+    int type;
+
+    do {
+        type = IMMEDIATE + (int) random_number(REGISTER_DIRECT);
+    } while (!(types & (1 << type)));
+
+    if (type == IMMEDIATE)
+        printf("%ld", (long) random_number(2 * MAX_IMMEDIATE + 1) - MAX_IMMEDIATE);
+    else if (type == REGISTER_DIRECT)
+        printf("@r%d", (int) random_number(REGISTERS));
+    else
+        print_label_name(options, externs);
+}
+
+
+/* Prints the name of a defined label or of an external */
+static void print_label_name(genptr options, unsigned long externs) {
+    unsigned long i = random_number(options->labels + externs);
+
+    if (i < options->labels)
+        printf("L%lu", i);
+    else
+        printf("X%lu", i - options->labels);
+}
+
+
+/* Returns a random number from 0 to 'limit' - 1 */
+static unsigned long random_number(unsigned long limit) {
+    unsigned long value = ((unsigned long) rand() << 15) ^ (unsigned long) rand();
+
+    return limit ? value % limit : 0;
+}
+
+
+/* Reads the options from the command line. Returns 0 on success, or -1 on invalid options */
+static int parse_options(int argc, char *argv[], genptr options) {
+    int i;
+    long value;
+
+    if (argc < 2 || (value = atol(argv[1])) < 1)
+        return -1;
+
+    options->lines = (unsigned long) value;
+    options->labels = options->lines / 10;
+    options->data_size = 6;
+    options->data = 20;
+    options->externs = 5;
+    options->entries = 5;
+    options->errors = 0;
+    options->comments = 5;
+    options->seed = 1;
+
+    for (i = 2; i < argc; i += 2) {
+        if (i + 1 >= argc || (value = atol(argv[i + 1])) < 0)
+            return -1;
+
+        if (!strcmp(argv[i], "--labels"))
+            options->labels = (unsigned long) value;
+        else if (!strcmp(argv[i], "--data"))
+            options->data = (int) value;
+        else if (!strcmp(argv[i], "--data-size"))
+            options->data_size = (unsigned long) (value ? value : 1);
+        else if (!strcmp(argv[i], "--externs"))
+            options->externs = (int) value;
+        else if (!strcmp(argv[i], "--entries"))
+            options->entries = (int) value;
+        else if (!strcmp(argv[i], "--errors"))
+            options->errors = (int) value;
+        else if (!strcmp(argv[i], "--comments"))
+            options->comments = (int) value;
+        else if (!strcmp(argv[i], "--seed"))
+            options->seed = (unsigned int) value;
+        else
+            return -1;
+    }
+
+    if (!options->labels)
+        options->labels = 1;            /* operations like 'lea' need a label */
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+/* This file is implementing the parallel assembling of multiple files.
+ * The files are assembled by a pool of worker threads, every job prints its messages
+ * into a memory stream of its own, and the messages are printed by the order of the files. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "jobs.h"
+#include "assemble.h"
+
+
+/* A file assembled by the workers */
+typedef struct job {
+    char *file_name;
+    char *output;                   /* Messages printed by the job */
+    size_t length;                  /* Length of the messages */
+    FILE *out;
+    Stats stats;                    /* Statistics of the job, if they are collected */
+    int result;
+    int done;
+} Job;
+
+
+/* The jobs shared by the workers */
+typedef struct pool {
+    Job *jobs;
+    int count;
+    int next;                       /* Index of the next job to take */
+    optptr options;
+    int collect;                    /* Collect the statistics of the jobs */
+    pthread_mutex_t lock;
+    pthread_cond_t finished;        /* Signaled whenever a job is done */
+} Pool;
+
+
+static void *worker(void *arg);
+
+static void run_job(Job *job, optptr options, int collect);
+
+static int allocate_error(char *func);
+
+
+/* Assembles files on 'options->jobs' threads and prints their messages by the order of the files.
+ * Returns the number of files that were assembled successfully */
+int assemble_parallel(char **files, int count, optptr options, statptr stats) {
+    Pool pool;
+    pthread_t *threads;
+    int i, run = 0, workers = options->jobs;
+
+    if (workers > count)
+        workers = count;
+
+    if (!(pool.jobs = (Job *) calloc((size_t) count, sizeof(Job))) ||
+        !(threads = (pthread_t *) malloc((size_t) workers * sizeof(pthread_t))))
+        exit(allocate_error("assemble_parallel"));
+
+    for (i = 0; i < count; i++) {
+        pool.jobs[i].file_name = files[i];
+        init_stats(&pool.jobs[i].stats);
+    }
+    pool.count = count;
+    pool.next = 0;
+    pool.options = options;
+    pool.collect = (stats != NULL);
+    pthread_mutex_init(&pool.lock, NULL);
+    pthread_cond_init(&pool.finished, NULL);
+
+    for (i = 0; i < workers; i++) {
+        if (pthread_create(&threads[i], NULL, worker, &pool)) {
+            fprintf(stderr, "*** ERROR: failed to create a worker thread. *** \n");
+            workers = i;
+            break;
+        }
+    }
+    if (!workers)
+        worker(&pool);          /* no threads, the jobs are done right here */
+
+    /* printing the messages of every job as soon as it and all the jobs before it are done */
+    for (i = 0; i < count; i++) {
+        Job *job = &pool.jobs[i];
+
+        pthread_mutex_lock(&pool.lock);
+        while (!job->done)
+            pthread_cond_wait(&pool.finished, &pool.lock);
+        pthread_mutex_unlock(&pool.lock);
+
+        fwrite(job->output, 1, job->length, stdout);
+        printf("\n\n");
+        free(job->output);
+        if (job->result)
+            run++;
+        if (stats)
+            merge_stats(stats, &job->stats);
+    }
+
+    for (i = 0; i < workers; i++)
+        pthread_join(threads[i], NULL);
+
+    pthread_cond_destroy(&pool.finished);
+    pthread_mutex_destroy(&pool.lock);
+    free(threads);
+    free(pool.jobs);
+
+    return run;
+}
+
+
+/* Takes jobs from the pool until there are none left */
+static void *worker(void *arg) {
+    Pool *pool = (Pool *) arg;
+    Job *job;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        job = pool->next < pool->count ? &pool->jobs[pool->next++] : NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (!job)
+            return NULL;
+
+        run_job(job, pool->options, pool->collect);
+
+        pthread_mutex_lock(&pool->lock);
+        job->done = 1;
+        pthread_cond_broadcast(&pool->finished);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+
+/* Assembles the file of a job, its messages are kept in memory */
+static void run_job(Job *job, optptr options, int collect) {
+    if (!(job->out = open_memstream(&job->output, &job->length)))
+        exit(allocate_error("run_job"));
+
+    job->result = assemble_file(job->file_name, options, job->out, collect ? &job->stats : NULL);
+
+    fclose(job->out);
+    job->out = NULL;
+}
+
+
+/* Memory allocation fail */
+static int allocate_error(char *func) {
+    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
+    return 1;
+}
@@ -0,0 +1,13 @@
+#ifndef PROJECT_JOBS_H
+#define PROJECT_JOBS_H
+
+#include "assemble.h"
+
+
+/* Assembles files on 'options->jobs' threads and prints their messages by the order of the files.
+ * The statistics of the files are added to 'stats' unless it's NULL.
+ * Returns the number of files that were assembled successfully */
+int assemble_parallel(char **files, int count, optptr options, statptr stats);
+
+
+#endif
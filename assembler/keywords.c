@@ -0,0 +1,101 @@
+/* This file is implementing the recognizer of the reserved words.
+ * A word is recognized by its length and then by its first characters,
+ * so it is compared to a single candidate at most. */
+
+#include <string.h>
+#include "keywords.h"
+#include "lexer.h"
+
+
+static Keyword match(const char *word, const char *candidate, KeywordKind kind, int code);
+
+static Keyword match_operation(const char *word);
+
+
+/* Recognizes the first 'length' characters of a word as a reserved word. Directives are given without their '.',
+ * and registers without their '@'. Returns a keyword of kind NO_KEYWORD if the word isn't reserved */
+Keyword find_keyword(const char *word, unsigned int length) {
+    Keyword keyword;
+
+    switch (length) {
+        case 2:
+            if (word[0] == 'r' && word[1] >= '0' && word[1] < '0' + REGISTERS) {
+                keyword.kind = REGISTER_KEYWORD;
+                keyword.code = word[1] - '0';
+                return keyword;
+            }
+            break;
+        case 3:
+            return match_operation(word);
+        case 4:
+            if (word[0] == 'd')
+                return match(word, "data", DIRECTIVE_KEYWORD, DATA);
+            if (word[0] == 's')
+                return match(word, "stop", OPERATION_KEYWORD, STOP);
+            break;
+        case 5:
+            return match(word, "entry", DIRECTIVE_KEYWORD, ENTRY);
+        case 6:
+            if (word[0] == 's')
+                return match(word, "string", DIRECTIVE_KEYWORD, STRING);
+            if (word[0] == 'e')
+                return match(word, "extern", DIRECTIVE_KEYWORD, EXTERN);
+            break;
+    }
+
+    return match(word, "", NO_KEYWORD, 0);
+}
+
+
+/* Used by 'find_keyword' to recognize the 3 letters operations */
+static Keyword match_operation(const char *word) {
+    switch (word[0]) {
+        case 'a':
+            return match(word, "add", OPERATION_KEYWORD, ADD);
+        case 'b':
+            return match(word, "bne", OPERATION_KEYWORD, BNE);
+        case 'c':
+            if (word[1] == 'm')
+                return match(word, "cmp", OPERATION_KEYWORD, CMP);
+            return match(word, "clr", OPERATION_KEYWORD, CLR);
+        case 'd':
+            return match(word, "dec", OPERATION_KEYWORD, DEC);
+        case 'i':
+            return match(word, "inc", OPERATION_KEYWORD, INC);
+        case 'j':
+            if (word[1] == 'm')
+                return match(word, "jmp", OPERATION_KEYWORD, JMP);
+            return match(word, "jsr", OPERATION_KEYWORD, JSR);
+        case 'l':
+            return match(word, "lea", OPERATION_KEYWORD, LEA);
+        case 'm':
+            return match(word, "mov", OPERATION_KEYWORD, MOV);
+        case 'n':
+            return match(word, "not", OPERATION_KEYWORD, NOT);
+        case 'p':
+            return match(word, "prn", OPERATION_KEYWORD, PRN);
+        case 'r':
+            if (word[1] == 'e')
+                return match(word, "red", OPERATION_KEYWORD, RED);
+            return match(word, "rts", OPERATION_KEYWORD, RTS);
+        case 's':
+            return match(word, "sub", OPERATION_KEYWORD, SUB);
+    }
+
+    return match(word, "", NO_KEYWORD, 0);
+}
+
+
+/* Returns the given keyword if the word is the candidate, else returns a keyword of kind NO_KEYWORD */
+static Keyword match(const char *word, const char *candidate, KeywordKind kind, int code) {
+    Keyword keyword;
+
+    keyword.kind = NO_KEYWORD;
+    keyword.code = 0;
+    if (kind != NO_KEYWORD && !memcmp(word, candidate, strlen(candidate))) {
+        keyword.kind = kind;
+        keyword.code = code;
+    }
+
+    return keyword;
+}
@@ -0,0 +1,23 @@
+#ifndef PROJECT_KEYWORDS_H
+#define PROJECT_KEYWORDS_H
+
+
+/* Kinds of reserved words */
+typedef enum keyword_kind {
+    NO_KEYWORD, OPERATION_KEYWORD, DIRECTIVE_KEYWORD, REGISTER_KEYWORD
+} KeywordKind;
+
+
+/* A reserved word of the language */
+typedef struct keyword {
+    KeywordKind kind;
+    int code;                       /* The operation, the type of the directive or the number of the register */
+} Keyword;
+
+
+/* Recognizes the first 'length' characters of a word as a reserved word. Directives are given without their '.',
+ * and registers without their '@'. Returns a keyword of kind NO_KEYWORD if the word isn't reserved */
+Keyword find_keyword(const char *word, unsigned int length);
+
+
+#endif
@@ -0,0 +1,295 @@
+/* This file is implementing the lexer of the assembler.
+ * Every source line is scanned once and split into a statement,
+ * which is used by both of the passes. */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "lexer.h"
+#include "symbols.h"
+#include "keywords.h"
+
+
+#define DECIMAL 10
+#define NO_OPERANDS 0
+#define ONE_OPERAND 1
+#define TWO_OPERANDS 2
+#define INITIAL_STATEMENTS 64
+
+enum {
+    FALSE, TRUE
+};
+
+
+static ErrorCode lex_directive(stmtptr statement, char *line, char *token, unsigned int length);
+
+static ErrorCode lex_operation(stmtptr statement, char *line, char *token, unsigned int length);
+
+static ErrorCode lex_operand(stmtptr statement, char *line, char **text, Operand *operand);
+
+static ErrorCode lex_error(stmtptr statement, char *line, char *position, ErrorCode code);
+
+static AddressingType get_addressing_type(const char *operand, unsigned int length, int *value);
+
+static StatementType get_directive(const char *token, unsigned int length);
+
+static int get_operation(const char *token, unsigned int length);
+
+static int is_name(const char *str, unsigned int length);
+
+static unsigned int get_name_length(const char *str);
+
+static unsigned int get_token_length(const char *str);
+
+static unsigned int get_trimmed_length(const char *str);
+
+static char *skip_spaces(char *address);
+
+
+/* Splits a source line into a statement. Returns 0 on success, else returns the code of the syntax error */
+ErrorCode lex_statement(char *line, unsigned int number, stmtptr statement) {
+    char *current = skip_spaces(line);
+    unsigned int length;
+
+    memset(statement, 0, sizeof(Statement));
+    statement->kind = EMPTY_STATEMENT;
+    statement->line = number;
+    statement->column = (unsigned int) (current - line) + 1;
+
+    if (*current == '\0' || *current == ';')       /* empty line or comment */
+        return 0;
+
+    length = get_name_length(current);
+    if (current[length] == ':') {
+        if (!is_name(current, length))
+            return lex_error(statement, line, current, INVALID_LABEL);
+        statement->label.start = current;
+        statement->label.length = length;
+        current = skip_spaces(current + length + 1);
+    }
+
+    if (!(length = get_token_length(current)))
+        return lex_error(statement, line, current, INVALID_STATEMENT);
+
+    if (*current == '.')
+        return lex_directive(statement, line, current, length);
+
+    return lex_operation(statement, line, current, length);
+}
+
+
+/* Create a new empty array of statements */
+stlptr new_statements(aptr arena) {
+    stlptr new = (stlptr) arena_alloc(arena, sizeof(Statements));
+
+    new->list = NULL;
+    new->count = 0;
+    new->capacity = 0;
+    new->arena = arena;
+
+    return new;
+}
+
+
+/* Adds a copy of a statement to the end of an array of statements */
+void add_statement(stlptr statements, stmtptr statement) {
+    if (statements->count == statements->capacity) {
+        unsigned int capacity = statements->capacity ? statements->capacity * 2 : INITIAL_STATEMENTS;
+        statements->list = (Statement *) arena_grow(statements->arena, statements->list,
+                                                    statements->capacity * sizeof(Statement),
+                                                    capacity * sizeof(Statement));
+        statements->capacity = capacity;
+    }
+
+    statements->list[statements->count++] = *statement;
+}
+
+
+/* Indicates if a given instruction is '.data' or '.string' */
+int is_data_statement(StatementType type) {
+    return (type == DATA || type == STRING);
+}
+
+
+/* Returns the number of required operands for a given operation */
+int get_number_of_operands(Operation op) {
+    if (op == MOV || op == CMP || op == ADD || op == SUB || op == LEA)
+        return TWO_OPERANDS;
+    if (op == RTS || op == STOP)
+        return NO_OPERANDS;
+    return ONE_OPERAND;
+}
+
+
+/* Used by 'lex_statement' to split a directive. The arguments of '.data' and '.string' are checked when stored */
+static ErrorCode lex_directive(stmtptr statement, char *line, char *token, unsigned int length) {
+    char *arguments = skip_spaces(token + length);
+
+    if (!(statement->directive = get_directive(token, length)))
+        return lex_error(statement, line, token, INVALID_STATEMENT);
+    statement->kind = DIRECTIVE_STATEMENT;
+
+    if (is_data_statement(statement->directive)) {
+        statement->arguments.start = arguments;
+        statement->arguments.length = get_trimmed_length(arguments);
+        return 0;
+    }
+
+    length = get_token_length(arguments);
+    if (!is_name(arguments, length) || *skip_spaces(arguments + length) != '\0')
+        return lex_error(statement, line, arguments, INVALID_LABEL);
+
+    statement->dst.text.start = arguments;
+    statement->dst.text.length = length;
+    statement->dst.type = DIRECT;
+
+    return 0;
+}
+
+
+/* Used by 'lex_statement' to split an operation and its operands */
+static ErrorCode lex_operation(stmtptr statement, char *line, char *token, unsigned int length) {
+    char *text = skip_spaces(token + length);
+    int operation, required;
+    ErrorCode error;
+
+    if ((operation = get_operation(token, length)) < 0)
+        return lex_error(statement, line, token, INVALID_STATEMENT);
+    statement->kind = OPERATION_STATEMENT;
+    statement->operation = (Operation) operation;
+
+    required = get_number_of_operands(statement->operation);
+    if (required == TWO_OPERANDS) {
+        if ((error = lex_operand(statement, line, &text, &statement->src)))
+            return error;
+        if (*text != ',')
+            return lex_error(statement, line, text, INVALID_STATEMENT);
+        text = skip_spaces(text + 1);
+    }
+    if (required != NO_OPERANDS && (error = lex_operand(statement, line, &text, &statement->dst)))
+        return error;
+
+    if (*text != '\0')
+        return lex_error(statement, line, text, INVALID_STATEMENT);
+
+    return 0;
+}
+
+
+/* Used by 'lex_operation' to split a single operand, 'text' is moved past the operand */
+static ErrorCode lex_operand(stmtptr statement, char *line, char **text, Operand *operand) {
+    char *start = *text, *end = *text;
+
+    while (*end != ',' && *end != '\0' && !isspace(*end))
+        end++;
+
+    operand->text.start = start;
+    operand->text.length = (unsigned int) (end - start);
+    if (!(operand->type = get_addressing_type(start, operand->text.length, &operand->value)))
+        return lex_error(statement, line, start, INVALID_STATEMENT);
+
+    *text = skip_spaces(end);
+
+    return 0;
+}
+
+
+/* Records the column of a syntax error. Returns the code of the error */
+static ErrorCode lex_error(stmtptr statement, char *line, char *position, ErrorCode code) {
+    statement->column = (unsigned int) (position - line) + 1;
+    return code;
+}
+
+
+/* Returns the addressing type of a given operand, and sets 'value' to its number or register */
+static AddressingType get_addressing_type(const char *operand, unsigned int length, int *value) {
+    unsigned int i = 0;
+    Keyword keyword;
+
+    if (operand[0] == '@') {
+        keyword = find_keyword(operand + 1, length - 1);
+        if (keyword.kind != REGISTER_KEYWORD)
+            return 0;
+        *value = keyword.code;
+        return REGISTER_DIRECT;
+    }
+
+    if (operand[0] == '+' || operand[0] == '-')
+        i++;
+    if (i < length && isdigit(operand[i])) {
+        while (i < length && isdigit(operand[i]))
+            i++;
+        if (i != length)
+            return 0;
+        *value = (int) strtol(operand, NULL, DECIMAL);
+        return IMMEDIATE;
+    }
+
+    if (is_name(operand, length))
+        return DIRECT;
+
+    return 0;
+}
+
+
+/* Returns the type of a directive, or 0 if it isn't a known directive */
+static StatementType get_directive(const char *token, unsigned int length) {
+    Keyword keyword = find_keyword(token + 1, length - 1);     /* skipping the '.' */
+
+    return (keyword.kind == DIRECTIVE_KEYWORD) ? (StatementType) keyword.code : 0;
+}
+
+
+/* Returns the code of a given operation, or -1 if it isn't a known operation */
+static int get_operation(const char *token, unsigned int length) {
+    Keyword keyword = find_keyword(token, length);
+
+    return (keyword.kind == OPERATION_KEYWORD) ? keyword.code : -1;
+}
+
+
+/* Checks if the first 'length' characters of a string are a valid label name */
+static int is_name(const char *str, unsigned int length) {
+    return (length && length <= MAX_LABEL_LENGTH && isalpha(*str) && get_name_length(str) >= length);
+}
+
+
+/* Returns the number of letters and digits at the start of a string */
+static unsigned int get_name_length(const char *str) {
+    unsigned int length = 0;
+
+    while (isalnum(str[length]))
+        length++;
+
+    return length;
+}
+
+
+/* Returns the number of characters until the next space */
+static unsigned int get_token_length(const char *str) {
+    unsigned int length = 0;
+
+    while (str[length] != '\0' && !isspace(str[length]))
+        length++;
+
+    return length;
+}
+
+
+/* Returns the length of a string without its trailing spaces */
+static unsigned int get_trimmed_length(const char *str) {
+    unsigned int length = (unsigned int) strlen(str);
+
+    while (length && isspace(str[length - 1]))
+        length--;
+
+    return length;
+}
+
+
+/* Returns a pointer to the next non-space character */
+static char *skip_spaces(char *address) {
+    while (isspace(*address))
+        address++;
+    return address;
+}
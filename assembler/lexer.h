@@ -0,0 +1,95 @@
+#ifndef PROJECT_LEXER_H
+#define PROJECT_LEXER_H
+
+#include "arena.h"
+#include "diagnostics.h"
+
+#define TOTAL_OPERATIONS 16         /* Number of supported operations */
+#define REGISTERS 8                 /* Number of available registers */
+
+
+/* Supported non-operations statements */
+typedef enum statement_type {
+    DATA = 1, STRING, ENTRY, EXTERN
+} StatementType;
+
+
+/* Supported operations */
+typedef enum operation {
+    MOV, CMP, ADD, SUB, NOT, CLR, LEA, INC, DEC, JMP, BNE, RED, PRN, JSR, RTS, STOP
+} Operation;
+
+
+/* Addressing type of an operand */
+typedef enum addressing_type {
+    IMMEDIATE = 1, DIRECT = 3, REGISTER_DIRECT = 5
+} AddressingType;
+
+
+/* Kinds of statements */
+typedef enum statement_kind {
+    EMPTY_STATEMENT, DIRECTIVE_STATEMENT, OPERATION_STATEMENT
+} StatementKind;
+
+
+/* A part of a source line - not terminated by '\0' */
+typedef struct span {
+    char *start;
+    unsigned int length;
+} Span;
+
+
+/* An operand of a statement */
+typedef struct operand {
+    Span text;
+    AddressingType type;            /* 0 if there's no operand */
+    int value;                      /* The number of an immediate operand, or of a register */
+} Operand;
+
+
+/* A source line, split into its parts. The spans point into the line */
+typedef struct statement *stmtptr;
+typedef struct statement {
+    StatementKind kind;
+    Span label;                     /* Empty if the statement has no label */
+    StatementType directive;        /* Type of a directive statement */
+    Operation operation;            /* Code of an operation statement */
+    Operand src;                    /* Missing on operations with less than 2 operands */
+    Operand dst;                    /* The only operand of an operation, or the label of '.entry' and '.extern' */
+    Span arguments;                 /* The arguments of '.data' and '.string' */
+    unsigned int line;
+    unsigned int column;            /* Column of the statement, or of its syntax error. Counted from 1 */
+} Statement;
+
+
+/* The statements which are kept for the second pass - a growable array */
+typedef struct statements *stlptr;
+typedef struct statements {
+    Statement *list;
+    unsigned int count;             /* Number of statements in the array */
+    unsigned int capacity;          /* Number of allocated statements */
+    aptr arena;                     /* The statements are allocated from this arena */
+} Statements;
+
+
+/* Splits a source line into a statement. Returns 0 on success, else returns the code of the syntax error */
+ErrorCode lex_statement(char *line, unsigned int number, stmtptr statement);
+
+
+/* Create a new empty array of statements */
+stlptr new_statements(aptr arena);
+
+
+/* Adds a copy of a statement to the end of an array of statements */
+void add_statement(stlptr statements, stmtptr statement);
+
+
+/* Indicates if a given instruction is '.data' or '.string' */
+int is_data_statement(StatementType type);
+
+
+/* Returns the number of required operands for a given operation */
+int get_number_of_operands(Operation op);
+
+
+#endif
@@ -0,0 +1,136 @@
+/* This file is implementing the library interface of the assembler.
+ * A source is assembled from memory into memory by the same passes as a file,
+ * with all of its memory in arenas - a failed allocation unwinds to 'assemble_buffer' instead of exiting. */
+
+#include <string.h>
+#include <setjmp.h>
+#include "library.h"
+
+
+enum {
+    FALSE, TRUE
+};
+
+
+static uint16_t *copy_words(segptr memory, aptr arena);
+
+static char *copy_name(const char *name, aptr arena);
+
+
+/* Assembles a source which is in memory, without reading or writing any file and without printing.
+ * The cache, the statistics and the threads options are ignored. Safe to call from several threads at once.
+ * Returns 1 on success, 0 if the source has errors, or -1 if there's no memory. Unless -1 is returned 'result' holds
+ * the errors, and the words and the symbols once the first pass succeeds. It must be freed by 'free_result' */
+int assemble_buffer(const char *text, size_t length, optptr options, resptr result) {
+    Assembly job;
+    Options job_options;
+    jmp_buf failure;
+    aptr arena;                     /* isn't changed after 'setjmp', so it's still valid after a failure */
+    int run;
+
+    memset(result, 0, sizeof(AssemblyResult));
+    if (!(result->arena = try_new_arena()))
+        return -1;
+    if (!(arena = try_new_arena())) {
+        free_result(result);
+        return -1;
+    }
+
+    if (setjmp(failure)) {          /* an allocation of the job or of its result failed */
+        delete_arena(arena);
+        free_result(result);
+        return -1;
+    }
+    arena->failure = &failure;
+    result->arena->failure = &failure;
+
+    job_options = *options;
+    job_options.cache_directory = NULL;
+    job_options.stats = FALSE;
+    job_options.threads = 0;         /* a failed allocation can't jump back from the threads of the chunks */
+
+    job.file_name = NULL;
+    job.address = job_options.address;
+    job.options = &job_options;
+    job.out = NULL;
+    job.stats = NULL;
+    job.arena = arena;
+    job.result = result;
+    init_diagnostics(&job.diagnostics, job_options.max_errors, arena);
+    init_buffer(&job.warnings, arena);
+    result->address = job.address;
+
+    run = assemble_source(&job, new_source(text, length, arena));
+
+    result->diagnostics_count = job.diagnostics.count;
+    result->diagnostics = (Diagnostic *) arena_alloc(result->arena, job.diagnostics.count * sizeof(Diagnostic) + 1);
+    if (job.diagnostics.count)
+        memcpy(result->diagnostics, job.diagnostics.list, job.diagnostics.count * sizeof(Diagnostic));
+
+    result->arena->failure = NULL;
+    delete_arena(arena);
+
+    return run;
+}
+
+
+/* Frees the outputs of an assembly */
+void free_result(resptr result) {
+    delete_arena(result->arena);
+    memset(result, 0, sizeof(AssemblyResult));
+}
+
+
+/* Copies the outputs of an assembled job into its result. Used by the second pass */
+void collect_result(resptr result, tptr symbols_table, segptr data_memory, segptr instruction_memory) {
+    unsigned int i, j;
+    sptr temp;
+
+    result->code_length = instruction_memory->length;
+    result->code = copy_words(instruction_memory, result->arena);
+    result->data_length = data_memory->length;
+    result->data = copy_words(data_memory, result->arena);
+
+    for (temp = symbols_table->head; temp; temp = temp->next) {
+        if (temp->type == ENTRY_SYMBOL)
+            result->entries_count++;
+    }
+    result->entries = (ResultSymbol *) arena_alloc(result->arena, result->entries_count * sizeof(ResultSymbol) + 1);
+    for (i = 0, temp = symbols_table->head; temp; temp = temp->next) {
+        if (temp->type == ENTRY_SYMBOL) {
+            result->entries[i].name = copy_name(temp->name, result->arena);
+            result->entries[i++].address = temp->value;
+        }
+    }
+
+    for (i = 0; i < instruction_memory->length; i++) {
+        if (instruction_memory->words[i].ext)
+            result->externals_count++;
+    }
+    result->externals = (ResultSymbol *) arena_alloc(result->arena,
+                                                     result->externals_count * sizeof(ResultSymbol) + 1);
+    for (i = j = 0; i < instruction_memory->length; i++) {
+        if (instruction_memory->words[i].ext) {
+            result->externals[j].name = copy_name(instruction_memory->words[i].ext, result->arena);
+            result->externals[j++].address = instruction_memory->base + i;
+        }
+    }
+}
+
+
+/* Copies the bits of the words of a segment */
+static uint16_t *copy_words(segptr memory, aptr arena) {
+    uint16_t *words = (uint16_t *) arena_alloc(arena, memory->length * sizeof(uint16_t) + 1);
+    unsigned int i;
+
+    for (i = 0; i < memory->length; i++)
+        words[i] = memory->words[i].binary_code;
+
+    return words;
+}
+
+
+/* Copies a name into the arena of the result, as the names of the job are freed with the job */
+static char *copy_name(const char *name, aptr arena) {
+    return arena_strndup(arena, name, strlen(name));
+}
@@ -0,0 +1,50 @@
+#ifndef PROJECT_LIBRARY_H
+#define PROJECT_LIBRARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "assemble.h"
+#include "memory.h"
+
+
+/* An entry or a use of an external in the outputs of an assembly */
+typedef struct result_symbol {
+    const char *name;
+    unsigned int address;
+} ResultSymbol;
+
+
+/* The outputs of a source assembled in memory - everything the .ob, .ent and .ext files would hold, and the errors.
+ * All of it is allocated from 'arena', and freed by 'free_result' */
+typedef struct assembly_result {
+    uint16_t *code;                 /* The instruction words, 12 bits in every word */
+    unsigned int code_length;
+    uint16_t *data;                 /* The data words, placed right after the instruction words */
+    unsigned int data_length;
+    unsigned int address;           /* Address of the first instruction word */
+    ResultSymbol *entries;
+    unsigned int entries_count;
+    ResultSymbol *externals;        /* Every word which uses an external, by the address of the word */
+    unsigned int externals_count;
+    Diagnostic *diagnostics;        /* The syntax errors, in the order they were found */
+    unsigned int diagnostics_count;
+    aptr arena;
+} AssemblyResult;
+
+
+/* Assembles a source which is in memory, without reading or writing any file and without printing.
+ * The cache, the statistics and the threads options are ignored. Safe to call from several threads at once.
+ * Returns 1 on success, 0 if the source has errors, or -1 if there's no memory. Unless -1 is returned 'result' holds
+ * the errors, and the words and the symbols once the first pass succeeds. It must be freed by 'free_result' */
+int assemble_buffer(const char *text, size_t length, optptr options, resptr result);
+
+
+/* Frees the outputs of an assembly */
+void free_result(resptr result);
+
+
+/* Copies the outputs of an assembled job into its result. Used by the second pass */
+void collect_result(resptr result, tptr symbols_table, segptr data_memory, segptr instruction_memory);
+
+
+#endif
@@ -0,0 +1,270 @@
+/* This file is implementing the linker, which joins assembled modules into a single loadable image.
+ * The code of all the modules comes first and then their data, by the order of the modules.
+ * The entries of all the modules are indexed in one hashed symbols table, every use of an external is patched
+ * with the address of its entry, and every relocatable word is moved by the new place of its module.
+ * Every module, entry and word is handled once, so the time is linear in the size of the modules. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "assemble.h"
+#include "module.h"
+#include "object.h"
+#include "output.h"
+
+
+#define DEFAULT_OUTPUT "linked"
+#define LARGEST_OPERAND_ADDRESS (WORD_MASK >> OPERAND_SHIFT)   /* An operand word holds a 10 bit address */
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* The addresses of the code and of the data of a module in the image */
+typedef struct placement {
+    unsigned int code;
+    unsigned int data;
+} Placement;
+
+
+static int parse_options(int argc, char *argv[], char **output, int *binary);
+
+static void place_modules(Module *modules, Placement *placements, int count);
+
+static int add_entries(tptr globals, modptr module, Placement *placement);
+
+static int link_module(tptr globals, modptr module, Placement *placement, segptr code, segptr data);
+
+static int place_address(modptr module, Placement *placement, unsigned int address, unsigned int *placed);
+
+static int write_image(char *output, int binary, tptr globals, segptr code, segptr data, aptr arena);
+
+static int create_image_file(bufptr buffer, char *output, char *extension, aptr arena);
+
+static int link_error(modptr module, const char *format, const char *name);
+
+
+int main(int argc, char *argv[]) {
+    int first, i, count, errors = 0, binary;
+    char *output;
+    Module *modules;
+    Placement *placements;
+    segptr code, data;
+    tptr globals;
+    aptr arena;
+
+    if ((first = parse_options(argc, argv, &output, &binary)) < 0 || first == argc) {
+        fprintf(stderr, "Usage: %s [-o output] [--binary] module...\n", argv[0]);
+        return 1;
+    }
+
+    arena = new_arena();            /* owns all the modules and the image */
+    count = argc - first;
+    modules = (Module *) arena_alloc(arena, (size_t) count * sizeof(Module));
+    placements = (Placement *) arena_alloc(arena, (size_t) count * sizeof(Placement));
+    for (i = 0; i < count; i++) {
+        if (!read_module(&modules[i], argv[first + i], DEFAULT_ADDRESS, arena))
+            errors++;
+    }
+
+    if (!errors) {
+        place_modules(modules, placements, count);
+        globals = new_symbols_table(arena);
+        for (i = 0; i < count; i++)
+            errors += add_entries(globals, &modules[i], &placements[i]);
+
+        code = new_segment(DEFAULT_ADDRESS, arena);
+        data = new_segment(placements[0].data, arena);
+        for (i = 0; i < count; i++)
+            errors += link_module(globals, &modules[i], &placements[i], code, data);
+
+        if (!errors) {
+            if (data->base + data->length - 1 > LARGEST_OPERAND_ADDRESS)
+                printf("WARNING: the image ends at address %u - an operand can't hold addresses above %u.\n",
+                       data->base + data->length - 1, LARGEST_OPERAND_ADDRESS);
+            errors += write_image(output, binary, globals, code, data, arena);
+            printf("Linked %d modules: %u code words, %u data words, %u entries.\n", count, code->length,
+                   data->length, globals->count);
+        }
+    }
+
+    delete_arena(arena);
+
+    return errors ? 1 : 0;
+}
+
+
+/* Reads the options from the command line. Returns the index of the first module, or -1 on invalid options */
+static int parse_options(int argc, char *argv[], char **output, int *binary) {
+    int i;
+
+    *output = DEFAULT_OUTPUT;
+    *binary = FALSE;
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (argv[i][1] == 'o') {
+            if (!(*output = argv[i][2] ? argv[i] + 2 : argv[++i]))
+                return -1;
+        } else if (!strcmp(argv[i], "--binary")) {
+            *binary = TRUE;
+        } else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i;
+}
+
+
+/* Places the code of all the modules at the start of the image, and their data after the code */
+static void place_modules(Module *modules, Placement *placements, int count) {
+    unsigned int address = DEFAULT_ADDRESS;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        placements[i].code = address;
+        address += modules[i].code_length;
+    }
+    for (i = 0; i < count; i++) {
+        placements[i].data = address;
+        address += modules[i].data_length;
+    }
+}
+
+
+/* Adds the entries of a module to the global entries, at their addresses in the image. Returns the number of errors */
+static int add_entries(tptr globals, modptr module, Placement *placement) {
+    unsigned int i, address;
+    int errors = 0;
+    sptr symbol;
+
+    for (i = 0; i < module->entries_count; i++) {
+        if (!place_address(module, placement, module->entries[i].address, &address))
+            errors += link_error(module, "entry '%s' is out of the module", module->entries[i].name);
+        else if (!(symbol = new_symbol(module->entries[i].name, address, ENTRY_SYMBOL, globals->arena)))
+            errors += link_error(module, "invalid entry name '%s'", module->entries[i].name);
+        else if (!add_symbol(globals, symbol))
+            errors += link_error(module, "entry '%s' is already defined by another module", symbol->name);
+    }
+
+    return errors;
+}
+
+
+/* Appends the words of a module to the image - relocates its relocatable words, and patches its uses of externals
+ * with the addresses of their entries. Returns the number of errors */
+static int link_module(tptr globals, modptr module, Placement *placement, segptr code, segptr data) {
+    unsigned int i, address, first = code->length;
+    uint16_t *word;
+    Word *target;
+    sptr symbol;
+    int errors = 0;
+
+    reserve_words(code, module->code_length);
+    for (i = 0, word = module->words; i < module->code_length; i++, word++) {
+        target = &code->words[code->length++];
+        target->binary_code = *word;
+        target->ext = NULL;
+        if ((*word & ENCTYPE_MASK) != RELOCATABLE)
+            continue;
+        if (!place_address(module, placement, (*word & WORD_MASK) >> OPERAND_SHIFT, &address))
+            errors += link_error(module, "a relocatable word is out of the module", "");
+        else
+            target->binary_code = (uint16_t) (((address << OPERAND_SHIFT) & WORD_MASK) | RELOCATABLE);
+    }
+
+    reserve_words(data, module->data_length);
+    for (i = 0; i < module->data_length; i++, word++) {
+        target = &data->words[data->length++];
+        target->binary_code = *word;
+        target->ext = NULL;
+    }
+
+    for (i = 0; i < module->externals_count; i++) {
+        address = module->externals[i].address - module->base;
+        if (module->externals[i].address < module->base || address >= module->code_length ||
+            (code->words[first + address].binary_code & ENCTYPE_MASK) != EXTERNAL)
+            errors += link_error(module, "use of external '%s' isn't an external word", module->externals[i].name);
+        else if (!(symbol = search_symbol(globals, module->externals[i].name)))
+            errors += link_error(module, "external '%s' isn't an entry of any module", module->externals[i].name);
+        else
+            code->words[first + address].binary_code =
+                    (uint16_t) (((symbol->value << OPERAND_SHIFT) & WORD_MASK) | RELOCATABLE);
+    }
+
+    return errors;
+}
+
+
+/* Finds the address in the image of an address of a module. Returns 1 on success, or 0 if it's out of the module */
+static int place_address(modptr module, Placement *placement, unsigned int address, unsigned int *placed) {
+    unsigned int offset = address - module->base;
+
+    if (address < module->base || offset >= module->code_length + module->data_length)
+        return FALSE;
+
+    if (offset < module->code_length)
+        *placed = placement->code + offset;
+    else
+        *placed = placement->data + offset - module->code_length;
+
+    return TRUE;
+}
+
+
+/* Writes the .ob file of the image and the .ent file of its entries, and the binary object if it's asked for.
+ * Returns the number of files which failed */
+static int write_image(char *output, int binary, tptr globals, segptr code, segptr data, aptr arena) {
+    Buffer buffer;
+    sptr symbol;
+    int errors;
+
+    init_buffer(&buffer, arena);
+    append_counts(&buffer, code->length, data->length);
+    append_words(&buffer, code);
+    append_words(&buffer, data);
+    errors = create_image_file(&buffer, output, TEXT_OBJECT_EXTENSION, arena);
+
+    init_buffer(&buffer, arena);
+    for (symbol = globals->head; symbol; symbol = symbol->next)
+        append_symbol(&buffer, symbol->name, symbol->value);
+    errors += create_image_file(&buffer, output, ".ent", arena);
+
+    if (binary) {
+        init_buffer(&buffer, arena);
+        append_object(&buffer, globals, data, code);
+        errors += create_image_file(&buffer, output, OBJECT_EXTENSION, arena);
+    }
+
+    return errors;
+}
+
+
+/* Writes a file of the image. An empty file isn't created, and an old one is removed. Returns 1 on failure, else 0 */
+static int create_image_file(bufptr buffer, char *output, char *extension, aptr arena) {
+    char *name = (char *) arena_alloc(arena, strlen(output) + strlen(extension) + 1);
+
+    strcpy(name, output);
+    strcat(name, extension);
+
+    if (!buffer->length)
+        remove(name);
+    else if (!write_buffer(buffer, name)) {
+        fprintf(stderr, "*** ERROR: failed to open '%s' *** \n", name);
+        return 1;
+    } else
+        printf("file created: '%s' \n", name);
+
+    return 0;
+}
+
+
+/* A module which can't be linked */
+static int link_error(modptr module, const char *format, const char *name) {
+    fprintf(stderr, "*** ERROR: '%s' - ", module->name);
+    fprintf(stderr, format, name);
+    fprintf(stderr, " *** \n");
+    return 1;
+}
@@ -0,0 +1,273 @@
+/* This file is implementing the emulator of the 12-bit machine.
+ * Every instruction is decoded once, when it's first executed, into its operation and the words its operands use,
+ * so running it again is a single dispatch on the operation. A write to memory drops the decoded instructions
+ * which may hold the written word, so a program which changes its own code still runs correctly.
+ * 'red' and 'prn' read and write the standard input and output in blocks. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include "machine.h"
+
+
+#define OPCODE_MASK 0xF
+#define TYPE_MASK 0x7
+#define REGISTER_MASK 0x1F
+#define ADDRESS_MASK (WORD_MASK >> OPERAND_SHIFT)
+#define SIGN_BIT (1 << (WORD_LENGTH - OPERAND_SHIFT - 1))   /* Sign of an immediate operand */
+#define END_OF_INPUT WORD_MASK                                  /* 'red' reads -1 at the end of the input */
+#define PADDING (2 * MAX_INSTRUCTION_LENGTH)    /* Words after the memory, so an instruction at its end is decoded */
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* Internal operations of the emulator, after the operations of the machine */
+enum {
+    NOT_DECODED = TOTAL_OPERATIONS
+};
+
+
+static int decode(machptr machine, unsigned int address);
+
+static int resolve(machptr machine, unsigned int type, unsigned int word, int register_shift, int is_address,
+                   uint16_t **location, uint16_t *value);
+
+static void drop_decoded(machptr machine, unsigned int address);
+
+static uint16_t read_input(IoBuffer *input, IoBuffer *output);
+
+static void write_output(IoBuffer *output, uint16_t value);
+
+static void flush_output(IoBuffer *output);
+
+
+/* Create a machine whose memory holds a module from its base address, which is where it starts.
+ * 'red' reads from 'in' and 'prn' writes to 'out' */
+machptr new_machine(modptr module, FILE *in, FILE *out, aptr arena) {
+    machptr new = (machptr) arena_calloc(arena, sizeof(Machine));
+    unsigned int total = module->code_length + module->data_length, i;
+
+    new->size = (module->base + total > MEMORY_SIZE) ? module->base + total : MEMORY_SIZE;
+    new->memory = (uint16_t *) arena_calloc(arena, (new->size + PADDING) * sizeof(uint16_t));
+    new->decoded = (Decoded *) arena_calloc(arena, (new->size + PADDING) * sizeof(Decoded));
+    for (i = 0; i < new->size + PADDING; i++)
+        new->decoded[i].operation = NOT_DECODED;
+
+    for (i = 0; i < total; i++)
+        new->memory[module->base + i] = (uint16_t) (module->words[i] & WORD_MASK);
+    new->pc = module->base;
+    new->input.fd = in;
+    new->output.fd = out;
+
+    return new;
+}
+
+
+/* Runs a machine until it stops, faults, or executes 'limit' instructions (0 for no limit) */
+MachineState run_machine(machptr machine, unsigned long limit) {
+    Decoded *decoded = machine->decoded, *current = decoded + machine->pc, *next;
+    uint16_t *memory = machine->memory;
+    unsigned long executed = 0;
+    int zero = machine->zero;
+    MachineState state = LIMIT_REACHED;
+
+    if (!limit)
+        limit = ULONG_MAX;
+
+    while (executed < limit) {
+        next = current + current->length;
+
+        switch (current->operation) {
+            case MOV:
+                *current->dst = *current->src;
+                break;
+            case CMP:
+                zero = !((*current->src - *current->dst) & WORD_MASK);
+                break;
+            case ADD:
+                *current->dst = (uint16_t) ((*current->dst + *current->src) & WORD_MASK);
+                break;
+            case SUB:
+                *current->dst = (uint16_t) ((*current->dst - *current->src) & WORD_MASK);
+                break;
+            case NOT:
+                *current->dst = (uint16_t) (~*current->dst & WORD_MASK);
+                break;
+            case CLR:
+                *current->dst = 0;
+                break;
+            case LEA:                           /* the source is resolved to its address */
+                *current->dst = *current->src;
+                break;
+            case INC:
+                *current->dst = (uint16_t) ((*current->dst + 1) & WORD_MASK);
+                break;
+            case DEC:
+                *current->dst = (uint16_t) ((*current->dst - 1) & WORD_MASK);
+                break;
+            case JMP:                           /* the destination of a jump is resolved to its address */
+                next = decoded + *current->dst;
+                break;
+            case BNE:
+                if (!zero)
+                    next = decoded + *current->dst;
+                break;
+            case RED:
+                *current->dst = read_input(&machine->input, &machine->output);
+                break;
+            case PRN:
+                write_output(&machine->output, *current->dst);
+                break;
+            case JSR:
+                if (machine->depth == STACK_SIZE) {
+                    state = STACK_OVERFLOW;
+                    goto end;
+                }
+                machine->stack[machine->depth++] = (unsigned int) (next - decoded);
+                next = decoded + *current->dst;
+                break;
+            case RTS:
+                if (!machine->depth) {
+                    state = STACK_UNDERFLOW;
+                    goto end;
+                }
+                next = decoded + machine->stack[--machine->depth];
+                break;
+            case STOP:
+                executed++;
+                state = STOPPED;
+                goto end;
+            default:                            /* not decoded yet - decoded and dispatched again */
+                if (!decode(machine, (unsigned int) (current - decoded))) {
+                    state = INVALID_INSTRUCTION;
+                    goto end;
+                }
+                continue;
+        }
+
+        if (current->writes_memory)
+            drop_decoded(machine, (unsigned int) (current->dst - memory));
+        current = next;
+        executed++;
+    }
+
+end:
+    machine->pc = (unsigned int) (current - decoded);
+    machine->zero = zero;
+    machine->executed += executed;
+    flush_output(&machine->output);
+
+    return state;
+}
+
+
+/* Decodes the instruction at an address. Returns 1 on success, or 0 if the words aren't a valid instruction */
+static int decode(machptr machine, unsigned int address) {
+    Decoded *decoded = &machine->decoded[address];
+    uint16_t *words = &machine->memory[address];
+    unsigned int operation = (words[0] >> OPCODE_SHIFT) & OPCODE_MASK;
+    unsigned int src = (words[0] >> SRC_TYPE_SHIFT) & TYPE_MASK, dst = (words[0] >> DST_TYPE_SHIFT) & TYPE_MASK;
+    int jump = (operation == JMP || operation == BNE || operation == JSR);
+    int writes = (operation != CMP && operation != PRN && !jump);
+
+    if ((words[0] & ENCTYPE_MASK) != ABSOLUTE || (src && !dst) ||
+        (src != 0) + (dst != 0) != get_number_of_operands((Operation) operation) ||
+        (operation == LEA && src != DIRECT) || (dst == IMMEDIATE && (writes || jump)))
+        return FALSE;
+
+    decoded->src = decoded->dst = NULL;
+    if (!dst)
+        decoded->length = 1;
+    else if (!src) {                    /* the only operand is encoded in the word of a source operand */
+        if (!resolve(machine, dst, words[1], SRC_REG_SHIFT, jump, &decoded->dst, &decoded->dst_value))
+            return FALSE;
+        decoded->length = 2;
+    } else {
+        if (!resolve(machine, src, words[1], SRC_REG_SHIFT, operation == LEA, &decoded->src, &decoded->src_value))
+            return FALSE;
+        if (src == REGISTER_DIRECT && dst == REGISTER_DIRECT) {
+            if (!resolve(machine, dst, words[1], DST_REG_SHIFT, FALSE, &decoded->dst, &decoded->dst_value))
+                return FALSE;
+            decoded->length = 2;
+        } else {
+            if (!resolve(machine, dst, words[2], DST_REG_SHIFT, FALSE, &decoded->dst, &decoded->dst_value))
+                return FALSE;
+            decoded->length = 3;
+        }
+    }
+
+    decoded->writes_memory = (unsigned char) (writes && dst == DIRECT);
+    decoded->operation = (unsigned char) operation;
+
+    return TRUE;
+}
+
+
+/* Finds the word an operand uses - a word of memory, a register, or the value of the operand itself.
+ * An address operand uses its address as a value. Returns 1 on success, or 0 on an invalid operand */
+static int resolve(machptr machine, unsigned int type, unsigned int word, int register_shift, int is_address,
+                   uint16_t **location, uint16_t *value) {
+    unsigned int operand = (word >> OPERAND_SHIFT) & ADDRESS_MASK, encoding = word & ENCTYPE_MASK;
+
+    if (type == IMMEDIATE && encoding == ABSOLUTE) {
+        *value = (uint16_t) ((operand & SIGN_BIT) ? (operand | ~ADDRESS_MASK) & WORD_MASK : operand);
+        *location = value;
+    } else if (type == DIRECT && encoding != EXTERNAL) {     /* an external has to be linked first */
+        *value = (uint16_t) operand;
+        *location = is_address ? value : &machine->memory[operand];
+    } else if (type == REGISTER_DIRECT && encoding == ABSOLUTE &&
+               ((word >> register_shift) & REGISTER_MASK) < REGISTERS)
+        *location = &machine->registers[(word >> register_shift) & REGISTER_MASK];
+    else
+        return FALSE;
+
+    return TRUE;
+}
+
+
+/* Drops the decoded instructions which may hold a word that was changed, they are decoded again when executed */
+static void drop_decoded(machptr machine, unsigned int address) {
+    unsigned int i;
+
+    for (i = 0; i < MAX_INSTRUCTION_LENGTH && i <= address; i++)
+        machine->decoded[address - i].operation = NOT_DECODED;
+}
+
+
+/* Reads a character of the input, -1 at its end. The output is flushed before waiting for more input */
+static uint16_t read_input(IoBuffer *input, IoBuffer *output) {
+    ssize_t count;
+
+    if (input->position == input->length) {
+        flush_output(output);
+        input->position = input->length = 0;
+        if ((count = read(fileno(input->fd), input->data, IO_BUFFER_SIZE)) <= 0)
+            return END_OF_INPUT;
+        input->length = (size_t) count;
+    }
+
+    return input->data[input->position++];
+}
+
+
+/* Writes a character to the output */
+static void write_output(IoBuffer *output, uint16_t value) {
+    if (output->position == IO_BUFFER_SIZE)
+        flush_output(output);
+    output->data[output->position++] = (unsigned char) value;
+}
+
+
+/* Writes the characters in the output buffer */
+static void flush_output(IoBuffer *output) {
+    if (output->position) {
+        fwrite(output->data, 1, output->position, output->fd);
+        fflush(output->fd);
+        output->position = 0;
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PROJECT_MACHINE_H
+#define PROJECT_MACHINE_H
+
+#include <stdio.h>
+#include "memory.h"
+#include "module.h"
+
+
+#define MEMORY_SIZE (WORD_MASK + 1)     /* Every 12 bit value is an address */
+#define STACK_SIZE 1024                 /* Number of nested 'jsr' calls */
+#define IO_BUFFER_SIZE 65536
+
+
+/* The state of a machine after a run */
+typedef enum machine_state {
+    STOPPED, LIMIT_REACHED, INVALID_INSTRUCTION, STACK_OVERFLOW, STACK_UNDERFLOW
+} MachineState;
+
+
+/* An instruction decoded once, when it's first executed. The operands are resolved to the words they use -
+ * a word of memory, a register, or the value of the operand itself */
+typedef struct decoded *decptr;
+typedef struct decoded {
+    uint16_t *src;
+    uint16_t *dst;
+    uint16_t src_value;             /* Value of an immediate source, or an address used as a value */
+    uint16_t dst_value;
+    unsigned char operation;        /* The operation, or an internal operation of the emulator */
+    unsigned char length;           /* Number of words of the instruction */
+    unsigned char writes_memory;    /* The instruction changes a word of memory, which may hold instructions */
+} Decoded;
+
+
+/* The standard input or output of a machine, read and written in blocks */
+typedef struct io_buffer {
+    FILE *fd;
+    unsigned char data[IO_BUFFER_SIZE];
+    size_t position;                /* Next character to read or write */
+    size_t length;                  /* Number of characters read into the buffer */
+} IoBuffer;
+
+
+/* The state of the emulated machine */
+typedef struct machine *machptr;
+typedef struct machine {
+    uint16_t *memory;
+    Decoded *decoded;               /* The decoded instruction at every address */
+    unsigned int size;              /* Number of words of memory */
+    uint16_t registers[REGISTERS];
+    unsigned int pc;                /* Address of the next instruction */
+    int zero;                       /* The zero flag, set by 'cmp' */
+    unsigned int stack[STACK_SIZE]; /* Return addresses of 'jsr' */
+    unsigned int depth;             /* Number of return addresses in the stack */
+    unsigned long executed;         /* Number of instructions executed */
+    IoBuffer input;
+    IoBuffer output;
+} Machine;
+
+
+/* Create a machine whose memory holds a module from its base address, which is where it starts.
+ * 'red' reads from 'in' and 'prn' writes to 'out' */
+machptr new_machine(modptr module, FILE *in, FILE *out, aptr arena);
+
+
+/* Runs a machine until it stops, faults, or executes 'limit' instructions (0 for no limit) */
+MachineState run_machine(machptr machine, unsigned long limit);
+
+
+#endif
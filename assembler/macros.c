@@ -0,0 +1,317 @@
+/* This file is implementing the macros of the assembler.
+ * A macro is defined by a line of 'mcro' and its name, the lines of its body and a line of 'endmcro',
+ * and a line which holds only the name of a defined macro is replaced by its body.
+ * The source is expanded in memory before the first pass - the macros are indexed in a hashed symbols table,
+ * the lines between the macros are copied in blocks, and every expanded line keeps its line in the original file
+ * so the errors are reported where they were written. */
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "macros.h"
+#include "symbols.h"
+
+
+#define INITIAL_LINES 256
+#define INITIAL_MACROS 16
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* A macro - its body is a block of lines of the original source */
+typedef struct macro {
+    size_t start;                   /* Offset of the body in the original text */
+    size_t end;                     /* Offset after the last line of the body */
+    unsigned int line;              /* Line of the first line of the body, counted from 1 */
+    unsigned int count;             /* Number of lines in the body */
+    int valid;                      /* A macro whose body has errors is expanded to nothing */
+} Macro;
+
+
+/* The state of the expansion of a source */
+typedef struct expansion *expptr;
+typedef struct expansion {
+    srcptr source;                  /* The original source */
+    char *text;                     /* The expanded text */
+    size_t length;                  /* Number of characters in 'text' */
+    size_t capacity;                /* Number of allocated characters */
+    unsigned int *origins;          /* Line in the original source of every expanded line */
+    unsigned int lines;             /* Number of expanded lines */
+    unsigned int lines_capacity;    /* Number of allocated origins */
+    Macro *macros;                  /* The defined macros, by the order of their definitions */
+    unsigned int count;             /* Number of defined macros */
+    unsigned int macros_capacity;   /* Number of allocated macros */
+    tptr table;                     /* The macros by name, the value of a symbol is the index of its macro */
+    dptr diagnostics;
+    aptr arena;                     /* Everything is allocated from the arena of the source */
+} Expansion;
+
+
+static int has_macros(srcptr source);
+
+static void init_expansion(expptr expansion, srcptr source, dptr diagnostics);
+
+static size_t define_macro(expptr expansion, size_t position, size_t next, unsigned int *line);
+
+static void add_macro(expptr expansion, char *word, unsigned int length, unsigned int line, unsigned int column,
+                      Macro *macro);
+
+static void append_text(expptr expansion, size_t start, size_t end, unsigned int first_line, unsigned int count);
+
+static size_t get_next_line(srcptr source, size_t position);
+
+static char *get_word(char *start, char *end, unsigned int *length);
+
+static int is_word(const char *word, unsigned int length, const char *keyword);
+
+static int is_blank(const char *start, const char *end);
+
+static int is_macro_name(const char *word, unsigned int length);
+
+
+/* Expands the macros of a source in memory, before the first pass. Returns a new source whose lines keep their
+ * lines in the original file, or the same source if it has no macros. The errors are added to 'diagnostics' */
+srcptr expand_macros(srcptr source, dptr diagnostics) {
+    Expansion expansion;
+    size_t position, next, block;
+    unsigned int line, block_line, length;
+    char *text = source->text, *word;
+    sptr symbol;
+    Macro *macro;
+    srcptr expanded;
+
+    if (!has_macros(source))
+        return source;
+
+    init_expansion(&expansion, source, diagnostics);
+    position = block = 0;
+    line = 0;
+    block_line = 1;                 /* the lines from 'block' are copied as they are, when a macro is reached */
+    while (position < source->length) {
+        next = get_next_line(source, position);
+        line++;
+        word = get_word(text + position, text + next, &length);
+
+        if (is_word(word, length, MACRO_START)) {
+            append_text(&expansion, block, position, block_line, line - block_line);
+            block = next = define_macro(&expansion, position, next, &line);
+            block_line = line + 1;
+        } else if (length && is_blank(word + length, text + next) &&
+                   (symbol = find_symbol(expansion.table, word, length))) {
+            append_text(&expansion, block, position, block_line, line - block_line);
+            macro = &expansion.macros[symbol->value];
+            if (macro->valid)
+                append_text(&expansion, macro->start, macro->end, macro->line, macro->count);
+            block = next;
+            block_line = line + 1;
+        }
+
+        position = next;
+    }
+    append_text(&expansion, block, source->length, block_line, line + 1 - block_line);
+
+    expanded = text_source(expansion.text, expansion.length, expansion.arena);
+    expanded->origins = expansion.origins;
+
+    return expanded;
+}
+
+
+/* Checks if the text of a source has the start of a macro definition anywhere, most sources have no macros */
+static int has_macros(srcptr source) {
+    const char *text = source->text, *end = source->text + source->length;
+    size_t length = strlen(MACRO_START);
+
+    while ((text = (const char *) memchr(text, MACRO_START[0], (size_t) (end - text))) &&
+           (size_t) (end - text) >= length) {
+        if (!memcmp(text, MACRO_START, length))
+            return TRUE;
+        text++;
+    }
+
+    return FALSE;
+}
+
+
+/* Initialize an empty expansion of a source */
+static void init_expansion(expptr expansion, srcptr source, dptr diagnostics) {
+    expansion->source = source;
+    expansion->arena = source->arena;
+    expansion->capacity = source->length + 2;      /* the usual source has about as many characters expanded */
+    expansion->text = (char *) arena_alloc(expansion->arena, expansion->capacity);
+    expansion->length = 0;
+    expansion->lines_capacity = INITIAL_LINES;
+    expansion->origins = (unsigned int *) arena_alloc(expansion->arena, INITIAL_LINES * sizeof(unsigned int));
+    expansion->lines = 0;
+    expansion->macros_capacity = INITIAL_MACROS;
+    expansion->macros = (Macro *) arena_alloc(expansion->arena, INITIAL_MACROS * sizeof(Macro));
+    expansion->count = 0;
+    expansion->table = new_symbols_table(expansion->arena);
+    expansion->diagnostics = diagnostics;
+}
+
+
+/* Reads the definition of a macro which starts at 'position', the line before 'next'.
+ * Returns the offset after its 'endmcro' line, and sets 'line' to the number of that line */
+static size_t define_macro(expptr expansion, size_t position, size_t next, unsigned int *line) {
+    srcptr source = expansion->source;
+    char *text = source->text, *start = text + position, *word, *name;
+    unsigned int length, name_length, column, definition_line = *line;
+    Macro macro;
+
+    word = get_word(start, text + next, &length);
+    column = (unsigned int) (word - start) + 1;
+    name = get_word(word + length, text + next, &name_length);
+    if (!is_blank(name + name_length, text + next))
+        name_length = 0;            /* nothing may follow the name */
+    macro.start = next;
+    macro.line = definition_line + 1;
+    macro.valid = TRUE;
+
+    while ((position = next) < source->length) {
+        next = get_next_line(source, position);
+        (*line)++;
+        start = text + position;
+        word = get_word(start, text + next, &length);
+
+        if (is_word(word, length, MACRO_END)) {
+            macro.end = position;
+            macro.count = *line - macro.line;
+            add_macro(expansion, name, name_length, definition_line, column, &macro);
+            if (!is_blank(word + length, text + next))
+                add_diagnostic(expansion->diagnostics, *line,
+                               (unsigned int) (get_word(word + length, text + next, &length) - start) + 1,
+                               INVALID_MACRO);
+            return next;
+        }
+
+        if (is_word(word, length, MACRO_START)) {      /* a macro can't be defined inside another one */
+            add_diagnostic(expansion->diagnostics, *line, (unsigned int) (word - start) + 1, INVALID_MACRO);
+            macro.valid = FALSE;
+        }
+    }
+
+    add_diagnostic(expansion->diagnostics, definition_line, column, UNTERMINATED_MACRO);
+    return source->length;
+}
+
+
+/* Adds a macro to the table by its name, which isn't terminated. Errors are reported at the 'mcro' of its line */
+static void add_macro(expptr expansion, char *word, unsigned int length, unsigned int line, unsigned int column,
+                      Macro *macro) {
+    char *name;
+    sptr symbol;
+
+    if (!is_macro_name(word, length)) {
+        add_diagnostic(expansion->diagnostics, line, column, INVALID_MACRO);
+        return;
+    }
+
+    name = (char *) arena_alloc(expansion->arena, length + 1);
+    memcpy(name, word, length);
+    name[length] = '\0';
+
+    if (!(symbol = new_symbol(name, expansion->count, MACRO_SYMBOL, expansion->arena)) ||
+        !strcmp(name, MACRO_START) || !strcmp(name, MACRO_END))
+        add_diagnostic(expansion->diagnostics, line, column, KEYWORD_MACRO);
+    else if (!add_symbol(expansion->table, symbol))
+        add_diagnostic(expansion->diagnostics, line, column, DUPLICATE_MACRO);
+    else {
+        if (expansion->count == expansion->macros_capacity) {
+            expansion->macros = (Macro *) arena_grow(expansion->arena, expansion->macros,
+                                                     expansion->macros_capacity * sizeof(Macro),
+                                                     expansion->macros_capacity * 2 * sizeof(Macro));
+            expansion->macros_capacity *= 2;
+        }
+        expansion->macros[expansion->count++] = *macro;
+    }
+}
+
+
+/* Appends a block of 'count' lines of the original text, whose first line is 'first_line' */
+static void append_text(expptr expansion, size_t start, size_t end, unsigned int first_line, unsigned int count) {
+    size_t length = end - start;
+    unsigned int i;
+
+    if (!count)
+        return;
+
+    if (expansion->length + length + 2 > expansion->capacity) {   /* room for a missing '\n' and the '\0' */
+        size_t capacity = expansion->capacity * 2;
+
+        while (expansion->length + length + 2 > capacity)
+            capacity *= 2;
+        expansion->text = (char *) arena_grow(expansion->arena, expansion->text, expansion->length, capacity);
+        expansion->capacity = capacity;
+    }
+    memcpy(expansion->text + expansion->length, expansion->source->text + start, length);
+    expansion->length += length;
+    if (expansion->text[expansion->length - 1] != '\n')        /* the last line of the file */
+        expansion->text[expansion->length++] = '\n';
+
+    if (expansion->lines + count > expansion->lines_capacity) {
+        unsigned int capacity = expansion->lines_capacity * 2;
+
+        while (expansion->lines + count > capacity)
+            capacity *= 2;
+        expansion->origins = (unsigned int *) arena_grow(expansion->arena, expansion->origins,
+                                                         expansion->lines * sizeof(unsigned int),
+                                                         capacity * sizeof(unsigned int));
+        expansion->lines_capacity = capacity;
+    }
+    for (i = 0; i < count; i++)
+        expansion->origins[expansion->lines++] = first_line + i;
+}
+
+
+/* Returns the offset of the line after the line at 'position' */
+static size_t get_next_line(srcptr source, size_t position) {
+    char *end = (char *) memchr(source->text + position, '\n', source->length - position);
+
+    return end ? (size_t) (end - source->text) + 1 : source->length;
+}
+
+
+/* Returns the first word between 'start' and 'end', and sets 'length' to its length (0 if there's no word) */
+static char *get_word(char *start, char *end, unsigned int *length) {
+    char *word;
+
+    while (start < end && isspace((unsigned char) *start))
+        start++;
+    for (word = start; start < end && !isspace((unsigned char) *start); start++)
+        ;
+    *length = (unsigned int) (start - word);
+
+    return word;
+}
+
+
+/* Checks if a word which isn't terminated is a given keyword */
+static int is_word(const char *word, unsigned int length, const char *keyword) {
+    return (length == strlen(keyword) && !strncmp(word, keyword, length));
+}
+
+
+/* Checks if the characters between 'start' and 'end' are all spaces */
+static int is_blank(const char *start, const char *end) {
+    while (start < end && isspace((unsigned char) *start))
+        start++;
+    return (start == end);
+}
+
+
+/* Checks if a word is a valid macro name - like the name of a label */
+static int is_macro_name(const char *word, unsigned int length) {
+    unsigned int i;
+
+    if (!length || length > MAX_LABEL_LENGTH || !isalpha((unsigned char) *word))
+        return FALSE;
+    for (i = 1; i < length; i++) {
+        if (!isalnum((unsigned char) word[i]))
+            return FALSE;
+    }
+
+    return TRUE;
+}
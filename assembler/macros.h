@@ -0,0 +1,17 @@
+#ifndef PROJECT_MACROS_H
+#define PROJECT_MACROS_H
+
+#include "source.h"
+#include "diagnostics.h"
+
+
+#define MACRO_START "mcro"          /* Starts the definition of a macro, followed by its name */
+#define MACRO_END "endmcro"         /* Ends the definition of a macro */
+
+
+/* Expands the macros of a source in memory, before the first pass. Returns a new source whose lines keep their
+ * lines in the original file, or the same source if it has no macros. The errors are added to 'diagnostics' */
+srcptr expand_macros(srcptr source, dptr diagnostics);
+
+
+#endif
@@ -0,0 +1,280 @@
+/*
+ *  This file includes the command line of the assembler.
+ *
+ * */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "assemble.h"
+#include "jobs.h"
+#include "server.h"
+
+
+#define MEGABYTE (1024UL * 1024)
+#define INITIAL_FILES 64
+#define INITIAL_LIST_SIZE 4096
+#define LIST_PREFIX '@'             /* Marks an argument which is a file of file names */
+#define STDIN_LIST "-"              /* The list name which reads the file names from the standard input */
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* The files to assemble, given on the command line and in lists of files - a growable array */
+typedef struct file_list {
+    char **names;
+    int count;
+    int capacity;
+} FileList;
+
+
+static int parse_options(int argc, char *argv[], optptr options);
+
+static int parse_format(char *value, DiagnosticsFormat *format);
+
+static int collect_files(int argc, char *argv[], int first, FileList *files);
+
+static int read_file_list(char *list_name, FileList *files);
+
+static char *read_stream(FILE *fd);
+
+static void add_file(FileList *files, char *name);
+
+static int allocate_error(char *func);
+
+
+int main(int argc, char *argv[]) {
+    int i, run = 0;
+    FileList files;
+    Options options;
+    Stats stats;
+    statptr collected;
+
+    if ((i = parse_options(argc, argv, &options)) < 0) {
+        fprintf(stderr, "Usage: %s [-j jobs] [-o directory] [--binary] [--threads count] [--one-pass] [--max-errors count] "
+                        "[--max-line-length length] [--error-format text|json] [--stats text|json] "
+                        "[--cache directory] [--cache-size megabytes] file|@list|@-...\n"
+                        "       %s [--one-pass] [--max-errors count] [--max-line-length length] "
+                        "[--error-format text|json] --server socket|-\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (options.server) {
+        if (!strcmp(options.server, STDIN_SERVER))
+            return serve_stream(stdin, stdout, &options);
+        return serve_socket(options.server, &options);
+    }
+
+    if (collect_files(argc, argv, i, &files) < 0)
+        return 1;
+    if (!files.count) {
+        printf("No input files detected. \n");
+        return 1;
+    }
+
+    init_stats(&stats);
+    collected = (options.stats || options.cache_directory) ? &stats : NULL;     /* the cache reports its hits */
+    if (options.jobs)
+        run = assemble_parallel(files.names, files.count, &options, collected);
+    else {
+        for (i = 0; i < files.count; i++) {
+            if (assemble_file(files.names[i], &options, stdout, collected))
+                run++;
+            printf("\n\n");
+        }
+    }
+
+    printf("Successfully assembled %d files out of %d.\n", run, files.count);
+    if (options.cache_directory) {
+        printf("Cache: %lu hits, %lu misses, %d entries evicted.\n", stats.cache_hits, stats.cache_misses,
+               evict_cache(options.cache_directory, options.cache_size));
+    }
+    if (options.stats)
+        print_stats(&stats, stdout, options.stats_format);
+
+    free(files.names);
+
+    return (run == files.count) ? 0 : 1;
+}
+
+
+/* Reads the options from the command line. Returns the index of the first file, or -1 on invalid options */
+static int parse_options(int argc, char *argv[], optptr options) {
+    int i;
+    char *value;
+
+    default_options(options);
+
+    for (i = 1; i < argc && argv[i][0] == '-'; i++) {
+        if (argv[i][1] == 'j') {
+            value = argv[i][2] ? argv[i] + 2 : argv[++i];
+            if (!value || (options->jobs = atoi(value)) < 1)
+                return -1;
+        } else if (argv[i][1] == 'o') {
+            if (!(options->output_directory = argv[i][2] ? argv[i] + 2 : argv[++i]))
+                return -1;
+        } else if (!strcmp(argv[i], "--binary")) {
+            options->binary = TRUE;
+        } else if (!strcmp(argv[i], "--threads")) {
+            if (!(value = argv[++i]) || (options->threads = atoi(value)) < 1)
+                return -1;
+        } else if (!strcmp(argv[i], "--one-pass")) {
+            options->one_pass = TRUE;
+        } else if (!strcmp(argv[i], "--max-errors")) {
+            if (!(value = argv[++i]) || atoi(value) < 1)
+                return -1;
+            options->max_errors = (unsigned int) atoi(value);
+        } else if (!strcmp(argv[i], "--max-line-length")) {
+            if (!(value = argv[++i]) || atoi(value) < 0)
+                return -1;
+            options->max_line_length = (unsigned int) atoi(value);
+        } else if (!strcmp(argv[i], "--error-format")) {
+            if (parse_format(argv[++i], &options->error_format) < 0)
+                return -1;
+        } else if (!strcmp(argv[i], "--stats")) {
+            if (parse_format(argv[++i], &options->stats_format) < 0)
+                return -1;
+            options->stats = TRUE;
+        } else if (!strcmp(argv[i], "--cache")) {
+            if (!(options->cache_directory = argv[++i]))
+                return -1;
+        } else if (!strcmp(argv[i], "--server")) {
+            if (!(options->server = argv[++i]))
+                return -1;
+        } else if (!strcmp(argv[i], "--cache-size")) {
+            if (!(value = argv[++i]) || atol(value) < 1)
+                return -1;
+            options->cache_size = (unsigned long) atol(value) * MEGABYTE;
+        } else {
+            fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+            return -1;
+        }
+    }
+
+    return i;
+}
+
+
+/* Reads an output format - 'text' or 'json'. Returns 0 on success, or -1 on invalid format */
+static int parse_format(char *value, DiagnosticsFormat *format) {
+    if (!value)
+        return -1;
+
+    if (!strcmp(value, "json"))
+        *format = JSON_FORMAT;
+    else if (!strcmp(value, "text"))
+        *format = TEXT_FORMAT;
+    else
+        return -1;
+
+    return 0;
+}
+
+
+/* Collects the files of the arguments from 'first' on. An argument '@list' is a file which lists a file in every line,
+ * and '@-' reads the list from the standard input. Returns 0 on success, or -1 if a list can't be read */
+static int collect_files(int argc, char *argv[], int first, FileList *files) {
+    int i;
+
+    files->names = NULL;
+    files->count = 0;
+    files->capacity = 0;
+
+    for (i = first; i < argc; i++) {
+        if (argv[i][0] != LIST_PREFIX)
+            add_file(files, argv[i]);
+        else if (read_file_list(argv[i] + 1, files) < 0) {
+            fprintf(stderr, "*** ERROR: failed to read the list of files '%s' *** \n", argv[i] + 1);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* Adds the files of a list. Empty lines and lines which start with '#' are skipped.
+ * Returns 0 on success, or -1 if the list can't be read */
+static int read_file_list(char *list_name, FileList *files) {
+    FILE *fd = strcmp(list_name, STDIN_LIST) ? fopen(list_name, "r") : stdin;
+    char *text, *line, *end;
+    size_t length;
+
+    if (!fd)
+        return -1;
+    text = read_stream(fd);
+    if (fd != stdin)
+        fclose(fd);
+    if (!text)
+        return -1;
+
+    /* the names point into the text, so it's kept until the end of the run */
+    for (line = text; *line; line = end) {
+        end = line + strcspn(line, "\n");
+        if (*end)
+            *end++ = '\0';
+
+        while (isspace((unsigned char) *line))
+            line++;
+        for (length = strlen(line); length && isspace((unsigned char) line[length - 1]); length--)
+            line[length - 1] = '\0';
+        if (*line && *line != '#')
+            add_file(files, line);
+    }
+
+    return 0;
+}
+
+
+/* Reads a whole stream into a string which is terminated by '\0'. Returns NULL if the stream can't be read */
+static char *read_stream(FILE *fd) {
+    size_t length = 0, capacity = INITIAL_LIST_SIZE, count;
+    char *text, *new;
+
+    if (!(text = (char *) malloc(capacity)))
+        exit(allocate_error("read_stream"));
+
+    while ((count = fread(text + length, 1, capacity - length - 1, fd)) > 0) {
+        length += count;
+        if (capacity - length == 1) {
+            if (!(new = (char *) realloc(text, capacity * 2)))
+                exit(allocate_error("read_stream"));
+            text = new;
+            capacity *= 2;
+        }
+    }
+    text[length] = '\0';
+
+    if (ferror(fd)) {
+        free(text);
+        return NULL;
+    }
+
+    return text;
+}
+
+
+/* Adds a file to the end of a list of files */
+static void add_file(FileList *files, char *name) {
+    char **new;
+
+    if (files->count == files->capacity) {
+        int capacity = files->capacity ? files->capacity * 2 : INITIAL_FILES;
+        if (!(new = (char **) realloc(files->names, (size_t) capacity * sizeof(char *))))
+            exit(allocate_error("add_file"));
+        files->names = new;
+        files->capacity = capacity;
+    }
+
+    files->names[files->count++] = name;
+}
+
+
+/* Memory allocation fail */
+static int allocate_error(char *func) {
+    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
+    return 1;
+}
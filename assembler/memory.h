@@ -1,89 +1,98 @@
 #ifndef PROJECT_INSTRUCTION_MEMORY_H
 #define PROJECT_INSTRUCTION_MEMORY_H
 
+#include <stdint.h>
 #include "symbols.h"
+#include "lexer.h"
 
 #define WORD_LENGTH 12              /* Number of bits in a memory word */
-#define TOTAL_OPERATIONS 16         /* Number of supported operations */
-#define REGISTERS 8                 /* Number of available registers */
-#define TOTAL_KEYWORDS 28           /* Number of supported keywords */
+#define WORD_MASK 0xFFF             /* Masks the 12 bits of a memory word */
+#define MAX_INSTRUCTION_LENGTH 3    /* Maximum number of words in an instruction */
 
 
-/* Supported non-operations statements */
-typedef enum statement_type {
-    DATA = 1, STRING, ENTRY, EXTERN
-} StatementType;
+/* Encoding type of a memory word (the 2 lowest bits) */
+typedef enum encoding_type {
+    ABSOLUTE, EXTERNAL, RELOCATABLE
+} EncodingType;
 
 
-/* Supported operations */
-typedef enum operation {
-    MOV, CMP, ADD, SUB, NOT, CLR, LEA, INC, DEC, JMP, BNE, RED, PRN, JSR, RTS, STOP
-} Operation;
+/* Layout of a memory word, given as the position of the lowest bit of every field */
+#define ENCTYPE_MASK 0x3            /* Bits 0-1: encoding type */
+#define DST_TYPE_SHIFT 2            /* Bits 2-4: destination addressing type (first word) */
+#define OPCODE_SHIFT 5              /* Bits 5-8: operation code (first word) */
+#define SRC_TYPE_SHIFT 9            /* Bits 9-11: source addressing type (first word) */
+#define OPERAND_SHIFT 2             /* Bits 2-11: value of an operand word */
+#define DST_REG_SHIFT 2             /* Bits 2-6: destination register */
+#define SRC_REG_SHIFT 7             /* Bits 7-11: source register */
 
 
-/* Addressing type of an operand */
-typedef enum addressing_type {
-    IMMEDIATE = 1, DIRECT = 3, REGISTER_DIRECT = 5
-} AddressingType;
-
-
-/* Memory word - used as a linked list */
+/* Memory word */
 typedef struct word *wptr;
 typedef struct word {
-    short binary_code[WORD_LENGTH];
-    unsigned int address;
-    char *ext;
-    wptr next;
+    uint16_t binary_code;           /* The 12 bits of the word, packed */
+    char *ext;                      /* Name of the external symbol used by the word, if any */
 } Word;
 
 
-/* Add a word to the memory */
-wptr add_word(wptr head, wptr new);
-
-
-/* Stores data in memory */
-wptr store_data(char *statement, unsigned int *data_counter);
-
+/* Memory segment - a growable array of words */
+typedef struct segment *segptr;
+typedef struct segment {
+    Word *words;
+    unsigned int length;            /* Number of words in the segment */
+    unsigned int capacity;          /* Number of allocated words */
+    unsigned int base;              /* Address of the first word */
+    aptr arena;                     /* The words are allocated from this arena */
+} Segment;
 
-/* Stores an instruction in memory */
-wptr store_instruction(char *instruction, unsigned int *instruction_counter, sptr symbols_table);
 
+/* A word which uses a label whose final address wasn't known when the word was created */
+typedef struct fixup {
+    unsigned int index;             /* Index of the word in its segment */
+    Span name;                      /* Name of the label */
+} Fixup;
 
-/* Checks if a given statement is an operation */
-int is_operation(char *statement);
 
+/* The words which are patched at the end of a single pass assembly - a growable array */
+typedef struct fixups *fxptr;
+typedef struct fixups {
+    Fixup *list;
+    unsigned int count;             /* Number of fixups in the array */
+    unsigned int capacity;          /* Number of allocated fixups */
+    aptr arena;                     /* The fixups are allocated from this arena */
+} Fixups;
 
-/* Returns the code of a given operation */
-Operation get_operation(char *statement);
 
+/* Create a new empty segment, its first word will be placed at 'base' */
+segptr new_segment(unsigned int base, aptr arena);
 
-/* Returns the label operand for 'entry' or 'extern' statement */
-char *get_label_operand(char *statement, StatementType type);
 
+/* Makes room for at least 'count' more words at the end of a segment */
+void reserve_words(segptr segment, unsigned int count);
 
-/* Indicates if a given instruction is '.data' or '.string' */
-int is_data_statement(StatementType type);
 
+/* Removes all the words of a segment past the first 'length' words */
+void truncate_segment(segptr segment, unsigned int length);
 
-/* Returns an operand as a string. if pos = 0 returns destination, if pos = 1 returns source. */
-char *get_operand(char *instruction, int pos);
 
+/* Stores the data of a '.data' or '.string' statement. Returns the number of words stored, or 0 on failure */
+int store_data(stmtptr statement, segptr data_memory);
 
-/* Returns the type of a non-operation instruction */
-StatementType get_statement_type(char *statement);
 
+/* Stores an operation statement in memory. Returns the number of words stored.
+ * If 'fixups' isn't NULL, the words of labels which aren't final yet are recorded there instead of being encoded */
+int store_instruction(stmtptr statement, segptr instruction_memory, tptr symbols_table, fxptr fixups);
 
-/* Returns the addressing type of a given operand */
-AddressingType get_addressing_type(char *operand);
 
+/* Returns the number of words of an operation statement, without storing it */
+int get_instruction_length(stmtptr statement);
 
-/* Returns the number of required operands for a given operation */
-int get_number_of_operands(Operation op);
 
+/* Create a new empty array of fixups */
+fxptr new_fixups(aptr arena);
 
-/* Delete memory and free all of its components */
-void delete_memory(wptr head);
 
+/* Encodes the recorded words, once all the labels are defined and the data symbols are updated */
+void resolve_fixups(fxptr fixups, segptr instruction_memory, tptr symbols_table);
 
 
 #endif
@@ -0,0 +1,240 @@
+/* This file is implementing the reading of assembled modules, for the tools which use the object files.
+ * A text module is decoded line by line through a table of the base-64 characters,
+ * and a binary object is mapped and copied by its sections. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include "module.h"
+#include "source.h"
+#include "object.h"
+
+
+#define ENT_EXTENSION ".ent"
+#define EXT_EXTENSION ".ext"
+#define INITIAL_SYMBOLS 16
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* The value of every character in base-64, -1 for the characters which aren't used */
+static const signed char base_64_values[UCHAR_MAX + 1] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 62, -1, -1, -1, 63,
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, -1, -1, -1, -1, -1, -1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, -1, -1, -1, -1, -1,
+    -1, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+    41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+
+static int read_text_module(modptr module, aptr arena);
+
+static int read_words(modptr module, char *file_name, aptr arena);
+
+static int read_binary_module(modptr module, const char *file_name, aptr arena);
+
+static char *create_name(const char *name, const char *extension, aptr arena);
+
+static int has_extension(const char *name, const char *extension);
+
+static int module_error(const char *file_name, const char *problem);
+
+
+/* Reads an assembled module - a binary object if the name ends with '.bo', else 'name.ob' with 'name.ent' and
+ * 'name.ext' if they exist, whose first word is at 'base'. Returns 1 on success, else prints the error and returns 0 */
+int read_module(modptr module, const char *file_name, unsigned int base, aptr arena) {
+    size_t length = strlen(file_name);
+
+    memset(module, 0, sizeof(Module));
+    module->base = base;
+
+    if (has_extension(file_name, OBJECT_EXTENSION)) {
+        module->name = arena_strndup(arena, file_name, length - strlen(OBJECT_EXTENSION));
+        return read_binary_module(module, file_name, arena);
+    }
+
+    if (has_extension(file_name, TEXT_OBJECT_EXTENSION))
+        length -= strlen(TEXT_OBJECT_EXTENSION);
+    module->name = arena_strndup(arena, file_name, length);
+
+    return read_text_module(module, arena);
+}
+
+
+/* Returns the value of a base-64 character of an object file, or -1 if it isn't one */
+int decode_base64(int c) {
+    return base_64_values[(unsigned char) c];
+}
+
+
+/* Reads the .ob file of a module, and its .ent and .ext files if they exist. Returns 1 on success, else returns 0 */
+static int read_text_module(modptr module, aptr arena) {
+    char *file_name;
+
+    if (!read_words(module, create_name(module->name, TEXT_OBJECT_EXTENSION, arena), arena))
+        return FALSE;
+
+    file_name = create_name(module->name, ENT_EXTENSION, arena);
+    if (!read_module_symbols(file_name, &module->entries, &module->entries_count, arena))
+        return module_error(file_name, "invalid entries file");
+
+    file_name = create_name(module->name, EXT_EXTENSION, arena);
+    if (!read_module_symbols(file_name, &module->externals, &module->externals_count, arena))
+        return module_error(file_name, "invalid externals file");
+
+    return TRUE;
+}
+
+
+/* Reads the words of an .ob file - a line of the counts of the code and the data words, and then 2 base-64 characters
+ * in a line for every word. Returns 1 on success, else prints the error and returns 0 */
+static int read_words(modptr module, char *file_name, aptr arena) {
+    srcptr source;
+    char *line, *end;
+    unsigned int length, i, total;
+    int high, low;
+
+    if (!(source = read_source(file_name, arena)))
+        return module_error(file_name, "failed to open");
+
+    if (!(line = next_line(source, &length)) || sscanf(line, "%u %u", &module->code_length, &module->data_length) != 2)
+        return module_error(file_name, "missing the counts of the words");
+
+    total = module->code_length + module->data_length;
+    if (total < module->code_length || source->length / 3 < total)     /* every word takes at least 3 characters */
+        return module_error(file_name, "invalid counts of the words");
+    module->words = (uint16_t *) arena_alloc(arena, (total ? total : 1) * sizeof(uint16_t));
+
+    for (i = 0; i < total; i++) {
+        if (!(line = next_line(source, &length)) || length < 2 || (high = decode_base64(line[0])) < 0 ||
+            (low = decode_base64(line[1])) < 0)
+            return module_error(file_name, "invalid word");
+        for (end = line + 2; isspace((unsigned char) *end); end++);
+        if (*end)
+            return module_error(file_name, "invalid word");
+        module->words[i] = (uint16_t) ((high << 6) | low);
+    }
+
+    while ((line = next_line(source, &length))) {
+        for (end = line; isspace((unsigned char) *end); end++);
+        if (*end)
+            return module_error(file_name, "more words than counted");
+    }
+
+    return TRUE;
+}
+
+
+/* Reads the lines of a label and an address of an .ent or an .ext file into a growable array.
+ * A missing file has no symbols. Returns 1 on success, or 0 on an invalid line */
+int read_module_symbols(char *file_name, ModuleSymbol **list, unsigned int *count, aptr arena) {
+    srcptr source;
+    char *line, *name, *end;
+    unsigned int length, capacity = 0;
+    unsigned long address;
+
+    if (!(source = read_source(file_name, arena)))
+        return TRUE;                    /* the assembler doesn't create empty files */
+
+    while ((line = next_line(source, &length))) {
+        for (name = line; isspace((unsigned char) *name); name++);
+        if (!*name)
+            continue;
+        for (end = name; *end && !isspace((unsigned char) *end); end++);
+        address = strtoul(end, &line, 10);
+        if (line == end)
+            return FALSE;
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : INITIAL_SYMBOLS;
+            *list = (ModuleSymbol *) arena_grow(arena, *list, *count * sizeof(ModuleSymbol),
+                                                capacity * sizeof(ModuleSymbol));
+        }
+        (*list)[*count].name = arena_strndup(arena, name, (size_t) (end - name));
+        (*list)[*count].address = (unsigned int) address;
+        (*count)++;
+    }
+
+    return TRUE;
+}
+
+
+/* Reads a binary object into a module. Returns 1 on success, else prints the error and returns 0 */
+static int read_binary_module(modptr module, const char *file_name, aptr arena) {
+    ObjectImage image;
+    ObjectSymbol symbol;
+    unsigned long i, total;
+
+    if (map_object(&image, file_name))
+        return module_error(file_name, "failed to open, or not a binary object");
+
+    module->base = (unsigned int) image.base;
+    module->code_length = (unsigned int) image.code_length;
+    module->data_length = (unsigned int) image.data_length;
+    total = image.code_length + image.data_length;
+    module->words = (uint16_t *) arena_alloc(arena, (total ? total : 1) * sizeof(uint16_t));
+    for (i = 0; i < total; i++)
+        module->words[i] = (uint16_t) get_object_word(&image, i);
+
+    module->entries_count = (unsigned int) image.entries_count;
+    module->entries = (ModuleSymbol *) arena_alloc(arena, (image.entries_count + 1) * sizeof(ModuleSymbol));
+    for (i = 0; i < image.entries_count; i++) {
+        symbol = get_object_entry(&image, i);
+        module->entries[i].name = arena_strndup(arena, symbol.name, strlen(symbol.name));
+        module->entries[i].address = (unsigned int) symbol.address;
+    }
+
+    module->externals_count = (unsigned int) image.externals_count;
+    module->externals = (ModuleSymbol *) arena_alloc(arena, (image.externals_count + 1) * sizeof(ModuleSymbol));
+    for (i = 0; i < image.externals_count; i++) {
+        symbol = get_object_external(&image, i);
+        module->externals[i].name = arena_strndup(arena, symbol.name, strlen(symbol.name));
+        module->externals[i].address = (unsigned int) symbol.address;
+    }
+
+    close_object(&image);
+
+    return TRUE;
+}
+
+
+/* Creates the name of a file of a module in the arena */
+static char *create_name(const char *name, const char *extension, aptr arena) {
+    size_t length = strlen(name);
+    char *file_name = (char *) arena_alloc(arena, length + strlen(extension) + 1);
+
+    strcpy(file_name, name);
+    strcpy(file_name + length, extension);
+
+    return file_name;
+}
+
+
+/* Checks if a file name ends with an extension */
+static int has_extension(const char *name, const char *extension) {
+    size_t length = strlen(name), extension_length = strlen(extension);
+
+    return length > extension_length && !strcmp(name + length - extension_length, extension);
+}
+
+
+/* An object file which can't be read */
+static int module_error(const char *file_name, const char *problem) {
+    fprintf(stderr, "*** ERROR: '%s' - %s *** \n", file_name, problem);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef PROJECT_MODULE_H
+#define PROJECT_MODULE_H
+
+#include <stdint.h>
+#include "arena.h"
+
+
+#define TEXT_OBJECT_EXTENSION ".ob"
+
+
+/* An entry of a module, or a use of an external by a word of a module */
+typedef struct module_symbol {
+    char *name;
+    unsigned int address;
+} ModuleSymbol;
+
+
+/* An assembled module - the words and the symbols of its object files */
+typedef struct module *modptr;
+typedef struct module {
+    char *name;                     /* Name of the module, without an extension */
+    uint16_t *words;                /* The code words and then the data words */
+    unsigned int code_length;       /* Number of code words */
+    unsigned int data_length;       /* Number of data words */
+    unsigned int base;              /* Address of the first code word */
+    ModuleSymbol *entries;
+    unsigned int entries_count;
+    ModuleSymbol *externals;        /* The uses of externals, by the order of their addresses */
+    unsigned int externals_count;
+} Module;
+
+
+/* Reads an assembled module - a binary object if the name ends with '.bo', else 'name.ob' with 'name.ent' and
+ * 'name.ext' if they exist, whose first word is at 'base'. Returns 1 on success, else prints the error and returns 0 */
+int read_module(modptr module, const char *file_name, unsigned int base, aptr arena);
+
+
+/* Reads the lines of a label and an address of an .ent or an .ext file into a growable array.
+ * A missing file has no symbols. Returns 1 on success, or 0 on an invalid line */
+int read_module_symbols(char *file_name, ModuleSymbol **list, unsigned int *count, aptr arena);
+
+
+/* Returns the value of a base-64 character of an object file, or -1 if it isn't one */
+int decode_base64(int c);
+
+
+#endif
@@ -0,0 +1,170 @@
+/* This file is implementing the reader of binary object files.
+ * A binary object is used in place - the header is checked once, the sections are located by their sizes,
+ * and every field is read from its little-endian bytes, so it doesn't depend on the byte order of the machine. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "object.h"
+
+
+enum {
+    FALSE, TRUE
+};
+
+
+static int locate_section(size_t *offset, size_t size, unsigned long count, size_t item_size);
+
+static ObjectSymbol get_symbol(objptr image, const unsigned char *section, unsigned long index);
+
+static unsigned int read_u16(const unsigned char *bytes);
+
+static unsigned long read_u32(const unsigned char *bytes);
+
+
+/* Locates the sections of a binary object which is in memory. The data isn't copied, so it should be kept.
+ * Returns 0 on success, or -1 if the data isn't a valid binary object */
+int open_object(objptr image, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    size_t offset;
+
+    memset(image, 0, sizeof(ObjectImage));
+    if (size < OBJECT_HEADER_SIZE || memcmp(bytes, OBJECT_MAGIC, OBJECT_MAGIC_LENGTH) ||
+        read_u16(bytes + VERSION_FIELD) != OBJECT_VERSION)
+        return -1;
+
+    offset = read_u16(bytes + HEADER_SIZE_FIELD);      /* a later version may add fields to the header */
+    image->base = read_u32(bytes + BASE_FIELD);
+    image->code_length = read_u32(bytes + CODE_FIELD);
+    image->data_length = read_u32(bytes + DATA_FIELD);
+    image->entries_count = read_u32(bytes + ENTRIES_FIELD);
+    image->externals_count = read_u32(bytes + EXTERNALS_FIELD);
+    image->relocations_count = read_u32(bytes + RELOCATIONS_FIELD);
+    image->names_size = read_u32(bytes + NAMES_FIELD);
+    if (offset < OBJECT_HEADER_SIZE || offset % OBJECT_ALIGNMENT || offset > size)
+        return -1;
+
+    /* every section is located right after the previous one, and the last one ends the data */
+    image->words = bytes + offset;
+    if (locate_section(&offset, size, image->code_length, OBJECT_WORD_SIZE) ||
+        locate_section(&offset, size, image->data_length, OBJECT_WORD_SIZE))
+        return -1;
+    if ((offset = (offset + OBJECT_ALIGNMENT - 1) / OBJECT_ALIGNMENT * OBJECT_ALIGNMENT) > size)
+        return -1;
+    image->entries = bytes + offset;
+    if (locate_section(&offset, size, image->entries_count, OBJECT_SYMBOL_SIZE))
+        return -1;
+    image->externals = bytes + offset;
+    if (locate_section(&offset, size, image->externals_count, OBJECT_SYMBOL_SIZE))
+        return -1;
+    image->relocations = bytes + offset;
+    if (locate_section(&offset, size, image->relocations_count, OBJECT_RELOCATION_SIZE))
+        return -1;
+    image->names = (const char *) bytes + offset;
+    if (size - offset != image->names_size || (image->names_size && bytes[size - 1] != '\0'))
+        return -1;
+
+    image->data = bytes;
+    image->size = size;
+
+    return 0;
+}
+
+
+/* Maps a binary object file into memory and locates its sections.
+ * Returns 0 on success, or -1 if the file can't be read or isn't a valid binary object */
+int map_object(objptr image, const char *file_name) {
+    struct stat info;
+    void *data;
+    int fd;
+
+    memset(image, 0, sizeof(ObjectImage));
+    if ((fd = open(file_name, O_RDONLY)) < 0)
+        return -1;
+    if (fstat(fd, &info) || info.st_size <= 0 ||
+        (data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    close(fd);                          /* the mapping stays valid */
+
+    if (open_object(image, data, (size_t) info.st_size)) {
+        munmap(data, (size_t) info.st_size);
+        return -1;
+    }
+    image->mapped = TRUE;
+
+    return 0;
+}
+
+
+/* Releases an object which was mapped by 'map_object'. Does nothing for an object opened by 'open_object' */
+void close_object(objptr image) {
+    if (image->mapped)
+        munmap((void *) image->data, image->size);
+    memset(image, 0, sizeof(ObjectImage));
+}
+
+
+/* Returns a word of the object by its index - the code words come first, then the data words */
+unsigned int get_object_word(objptr image, unsigned long index) {
+    return read_u16(image->words + index * OBJECT_WORD_SIZE);
+}
+
+
+/* Returns an entry of the object by its index */
+ObjectSymbol get_object_entry(objptr image, unsigned long index) {
+    return get_symbol(image, image->entries, index);
+}
+
+
+/* Returns a use of an external by its index, by the order of the addresses */
+ObjectSymbol get_object_external(objptr image, unsigned long index) {
+    return get_symbol(image, image->externals, index);
+}
+
+
+/* Returns the address of a relocatable word by its index, by the order of the addresses */
+unsigned long get_object_relocation(objptr image, unsigned long index) {
+    return read_u32(image->relocations + index * OBJECT_RELOCATION_SIZE);
+}
+
+
+/* Moves 'offset' past a section of 'count' items. Returns 0 on success, or -1 if the section doesn't fit in 'size' */
+static int locate_section(size_t *offset, size_t size, unsigned long count, size_t item_size) {
+    if (count > (size - *offset) / item_size)
+        return -1;
+    *offset += (size_t) count * item_size;
+
+    return 0;
+}
+
+
+/* Reads a symbol of a section. A name out of the names section is read as an empty name */
+static ObjectSymbol get_symbol(objptr image, const unsigned char *section, unsigned long index) {
+    const unsigned char *symbol = section + index * OBJECT_SYMBOL_SIZE;
+    unsigned long offset = read_u32(symbol + OBJECT_SYMBOL_SIZE / 2);
+    ObjectSymbol result;
+
+    result.address = read_u32(symbol);
+    result.name = (offset < image->names_size) ? image->names + offset : "";
+
+    return result;
+}
+
+
+/* Reads a little-endian 16 bit number */
+static unsigned int read_u16(const unsigned char *bytes) {
+    return (unsigned int) bytes[0] | ((unsigned int) bytes[1] << 8);
+}
+
+
+/* Reads a little-endian 32 bit number */
+static unsigned long read_u32(const unsigned char *bytes) {
+    return (unsigned long) bytes[0] | ((unsigned long) bytes[1] << 8) | ((unsigned long) bytes[2] << 16) |
+           ((unsigned long) bytes[3] << 24);
+}
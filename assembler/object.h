@@ -0,0 +1,91 @@
+#ifndef PROJECT_OBJECT_H
+#define PROJECT_OBJECT_H
+
+#include <stddef.h>
+
+
+/* Layout of a binary object file. All the numbers are little-endian, and every section starts at a multiple of 4:
+ *   header       "AS12", u16 version, u16 size of the header, and u32 fields - the address of the first code word,
+ *                the number of code words, data words, entries, externals and relocations, and the size of the names
+ *   words        a u16 for every code word and then for every data word, padded by zeros to a multiple of 4 bytes
+ *   entries      a u32 address and a u32 offset of the name, for every entry
+ *   externals    a u32 address of a word which uses an external and a u32 offset of its name, for every use
+ *   relocations  a u32 address of every relocatable code word
+ *   names        the names, every one terminated by '\0' */
+#define OBJECT_MAGIC "AS12"
+#define OBJECT_MAGIC_LENGTH 4
+#define OBJECT_VERSION 1
+#define OBJECT_HEADER_SIZE 36
+#define OBJECT_WORD_SIZE 2
+#define OBJECT_ALIGNMENT 4          /* Every section starts at a multiple of this size */
+#define OBJECT_SYMBOL_SIZE 8        /* Size of an entry or an external */
+#define OBJECT_RELOCATION_SIZE 4
+#define OBJECT_EXTENSION ".bo"
+
+
+/* Positions of the fields of the header */
+typedef enum object_field {
+    VERSION_FIELD = 4, HEADER_SIZE_FIELD = 6, BASE_FIELD = 8, CODE_FIELD = 12, DATA_FIELD = 16, ENTRIES_FIELD = 20,
+    EXTERNALS_FIELD = 24, RELOCATIONS_FIELD = 28, NAMES_FIELD = 32
+} ObjectField;
+
+
+/* An entry or a use of an external in a binary object */
+typedef struct object_symbol {
+    const char *name;
+    unsigned long address;
+} ObjectSymbol;
+
+
+/* A binary object in memory, with its sections located */
+typedef struct object_image *objptr;
+typedef struct object_image {
+    const unsigned char *data;      /* The whole file */
+    size_t size;
+    unsigned long base;             /* Address of the first code word */
+    unsigned long code_length;
+    unsigned long data_length;
+    unsigned long entries_count;
+    unsigned long externals_count;
+    unsigned long relocations_count;
+    unsigned long names_size;
+    const unsigned char *words;
+    const unsigned char *entries;
+    const unsigned char *externals;
+    const unsigned char *relocations;
+    const char *names;
+    int mapped;                     /* The data is mapped by 'map_object' */
+} ObjectImage;
+
+
+/* Locates the sections of a binary object which is in memory. The data isn't copied, so it should be kept.
+ * Returns 0 on success, or -1 if the data isn't a valid binary object */
+int open_object(objptr image, const void *data, size_t size);
+
+
+/* Maps a binary object file into memory and locates its sections.
+ * Returns 0 on success, or -1 if the file can't be read or isn't a valid binary object */
+int map_object(objptr image, const char *file_name);
+
+
+/* Releases an object which was mapped by 'map_object'. Does nothing for an object opened by 'open_object' */
+void close_object(objptr image);
+
+
+/* Returns a word of the object by its index - the code words come first, then the data words */
+unsigned int get_object_word(objptr image, unsigned long index);
+
+
+/* Returns an entry of the object by its index */
+ObjectSymbol get_object_entry(objptr image, unsigned long index);
+
+
+/* Returns a use of an external by its index, by the order of the addresses */
+ObjectSymbol get_object_external(objptr image, unsigned long index);
+
+
+/* Returns the address of a relocatable word by its index, by the order of the addresses */
+unsigned long get_object_relocation(objptr image, unsigned long index);
+
+
+#endif
@@ -0,0 +1,299 @@
+/* This file is implementing the output files of the assembler.
+ * The content of every file is built in a memory buffer,
+ * and written with a single call once it's complete. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "output.h"
+#include "object.h"
+
+
+#define WORD_LINE_LENGTH 3          /* 2 base-64 characters and '\n' */
+#define NUMBER_LENGTH 12            /* Room for a printed unsigned int and a separator */
+#define SYMBOL_NAME_WIDTH 10        /* Names in the entries and the externals files are padded to this width */
+#define INITIAL_BUFFER_SIZE 256
+#define DIRECTORY_MODE 0777
+
+
+static unsigned char *put_words(unsigned char *current, segptr memory);
+
+static unsigned char *put_symbol(unsigned char *current, unsigned long address, unsigned long name_offset);
+
+static void put_u16(unsigned char *bytes, unsigned int value);
+
+static void put_u32(unsigned char *bytes, unsigned long value);
+
+
+/* All the 64 words which share their upper half, by their lower half */
+#define BASE64_ROW(c) \
+    {c, 'A'}, {c, 'B'}, {c, 'C'}, {c, 'D'}, {c, 'E'}, {c, 'F'}, {c, 'G'}, {c, 'H'},\
+    {c, 'I'}, {c, 'J'}, {c, 'K'}, {c, 'L'}, {c, 'M'}, {c, 'N'}, {c, 'O'}, {c, 'P'},\
+    {c, 'Q'}, {c, 'R'}, {c, 'S'}, {c, 'T'}, {c, 'U'}, {c, 'V'}, {c, 'W'}, {c, 'X'},\
+    {c, 'Y'}, {c, 'Z'}, {c, 'a'}, {c, 'b'}, {c, 'c'}, {c, 'd'}, {c, 'e'}, {c, 'f'},\
+    {c, 'g'}, {c, 'h'}, {c, 'i'}, {c, 'j'}, {c, 'k'}, {c, 'l'}, {c, 'm'}, {c, 'n'},\
+    {c, 'o'}, {c, 'p'}, {c, 'q'}, {c, 'r'}, {c, 's'}, {c, 't'}, {c, 'u'}, {c, 'v'},\
+    {c, 'w'}, {c, 'x'}, {c, 'y'}, {c, 'z'}, {c, '0'}, {c, '1'}, {c, '2'}, {c, '3'},\
+    {c, '4'}, {c, '5'}, {c, '6'}, {c, '7'}, {c, '8'}, {c, '9'}, {c, '+'}, {c, '/'}
+
+
+/* The 2 base-64 characters of every 12-bit word - the character of the upper half first */
+static const char base_64[WORD_MASK + 1][2] = {
+    BASE64_ROW('A'), BASE64_ROW('B'), BASE64_ROW('C'), BASE64_ROW('D'),
+    BASE64_ROW('E'), BASE64_ROW('F'), BASE64_ROW('G'), BASE64_ROW('H'),
+    BASE64_ROW('I'), BASE64_ROW('J'), BASE64_ROW('K'), BASE64_ROW('L'),
+    BASE64_ROW('M'), BASE64_ROW('N'), BASE64_ROW('O'), BASE64_ROW('P'),
+    BASE64_ROW('Q'), BASE64_ROW('R'), BASE64_ROW('S'), BASE64_ROW('T'),
+    BASE64_ROW('U'), BASE64_ROW('V'), BASE64_ROW('W'), BASE64_ROW('X'),
+    BASE64_ROW('Y'), BASE64_ROW('Z'), BASE64_ROW('a'), BASE64_ROW('b'),
+    BASE64_ROW('c'), BASE64_ROW('d'), BASE64_ROW('e'), BASE64_ROW('f'),
+    BASE64_ROW('g'), BASE64_ROW('h'), BASE64_ROW('i'), BASE64_ROW('j'),
+    BASE64_ROW('k'), BASE64_ROW('l'), BASE64_ROW('m'), BASE64_ROW('n'),
+    BASE64_ROW('o'), BASE64_ROW('p'), BASE64_ROW('q'), BASE64_ROW('r'),
+    BASE64_ROW('s'), BASE64_ROW('t'), BASE64_ROW('u'), BASE64_ROW('v'),
+    BASE64_ROW('w'), BASE64_ROW('x'), BASE64_ROW('y'), BASE64_ROW('z'),
+    BASE64_ROW('0'), BASE64_ROW('1'), BASE64_ROW('2'), BASE64_ROW('3'),
+    BASE64_ROW('4'), BASE64_ROW('5'), BASE64_ROW('6'), BASE64_ROW('7'),
+    BASE64_ROW('8'), BASE64_ROW('9'), BASE64_ROW('+'), BASE64_ROW('/')
+};
+
+
+/* Initialize an empty buffer */
+void init_buffer(bufptr buffer, aptr arena) {
+    buffer->data = NULL;
+    buffer->length = 0;
+    buffer->capacity = 0;
+    buffer->arena = arena;
+}
+
+
+/* Makes room for at least 'count' more characters at the end of a buffer */
+void reserve_buffer(bufptr buffer, size_t count) {
+    size_t capacity = buffer->capacity ? buffer->capacity : INITIAL_BUFFER_SIZE;
+
+    if (buffer->length + count <= buffer->capacity)
+        return;
+
+    while (capacity < buffer->length + count)
+        capacity *= 2;
+
+    buffer->data = (char *) arena_grow(buffer->arena, buffer->data, buffer->length, capacity);
+    buffer->capacity = capacity;
+}
+
+
+/* Appends the header line of an object file - the number of instruction words and of data words */
+void append_counts(bufptr buffer, unsigned int instructions, unsigned int data) {
+    reserve_buffer(buffer, 2 * NUMBER_LENGTH);
+    buffer->length += (size_t) sprintf(buffer->data + buffer->length, "%u %u\n", instructions, data);
+}
+
+
+/* Appends the words of a segment, 2 base-64 characters in a line for every word */
+void append_words(bufptr buffer, segptr memory) {
+    Word *word, *end = memory->words + memory->length;
+    char *current;
+
+    reserve_buffer(buffer, (size_t) memory->length * WORD_LINE_LENGTH);
+    current = buffer->data + buffer->length;
+
+    for (word = memory->words; word < end; word++) {
+        current[0] = base_64[word->binary_code & WORD_MASK][0];
+        current[1] = base_64[word->binary_code & WORD_MASK][1];
+        current[2] = '\n';
+        current += WORD_LINE_LENGTH;
+    }
+
+    buffer->length = (size_t) (current - buffer->data);
+}
+
+
+/* Appends 'count' words which are given by their bits, like 'append_words' */
+void append_codes(bufptr buffer, const uint16_t *codes, unsigned int count) {
+    const uint16_t *code, *end = codes + count;
+    char *current;
+
+    reserve_buffer(buffer, (size_t) count * WORD_LINE_LENGTH);
+    current = buffer->data + buffer->length;
+
+    for (code = codes; code < end; code++) {
+        current[0] = base_64[*code & WORD_MASK][0];
+        current[1] = base_64[*code & WORD_MASK][1];
+        current[2] = '\n';
+        current += WORD_LINE_LENGTH;
+    }
+
+    buffer->length = (size_t) (current - buffer->data);
+}
+
+
+/* Appends a binary object - the header, the words of the instructions and of the data, the entries,
+ * the uses of externals and the relocatable words, in the layout of 'object.h' */
+void append_object(bufptr buffer, tptr symbols_table, segptr data_memory, segptr instruction_memory) {
+    unsigned long entries = 0, externals = 0, relocations = 0, names_size = 0, offset = 0;
+    size_t words_size, total, length;
+    unsigned char *start, *current, *relocation, *names;
+    Word *word;
+    sptr symbol;
+    unsigned int i;
+
+    /* the sizes of all the sections are counted first, so the object is written by a single pass */
+    for (symbol = symbols_table->head; symbol; symbol = symbol->next) {
+        if (symbol->type == ENTRY_SYMBOL) {
+            entries++;
+            names_size += strlen(symbol->name) + 1;
+        }
+    }
+    for (word = instruction_memory->words; word < instruction_memory->words + instruction_memory->length; word++) {
+        if (word->ext) {
+            externals++;
+            names_size += strlen(word->ext) + 1;
+        } else if ((word->binary_code & ENCTYPE_MASK) == RELOCATABLE)
+            relocations++;
+    }
+
+    words_size = ((size_t) instruction_memory->length + data_memory->length) * OBJECT_WORD_SIZE;
+    words_size = (words_size + OBJECT_ALIGNMENT - 1) / OBJECT_ALIGNMENT * OBJECT_ALIGNMENT;
+    total = OBJECT_HEADER_SIZE + words_size + (entries + externals) * OBJECT_SYMBOL_SIZE +
+            relocations * OBJECT_RELOCATION_SIZE + names_size;
+    reserve_buffer(buffer, total);
+    start = (unsigned char *) buffer->data + buffer->length;
+    memset(start, 0, total);            /* the padding */
+
+    memcpy(start, OBJECT_MAGIC, OBJECT_MAGIC_LENGTH);
+    put_u16(start + VERSION_FIELD, OBJECT_VERSION);
+    put_u16(start + HEADER_SIZE_FIELD, OBJECT_HEADER_SIZE);
+    put_u32(start + BASE_FIELD, instruction_memory->base);
+    put_u32(start + CODE_FIELD, instruction_memory->length);
+    put_u32(start + DATA_FIELD, data_memory->length);
+    put_u32(start + ENTRIES_FIELD, entries);
+    put_u32(start + EXTERNALS_FIELD, externals);
+    put_u32(start + RELOCATIONS_FIELD, relocations);
+    put_u32(start + NAMES_FIELD, names_size);
+
+    put_words(put_words(start + OBJECT_HEADER_SIZE, instruction_memory), data_memory);
+    current = start + OBJECT_HEADER_SIZE + words_size;
+    relocation = current + (entries + externals) * OBJECT_SYMBOL_SIZE;
+    names = relocation + relocations * OBJECT_RELOCATION_SIZE;
+
+    for (symbol = symbols_table->head; symbol; symbol = symbol->next) {
+        if (symbol->type == ENTRY_SYMBOL) {
+            current = put_symbol(current, symbol->value, offset);
+            length = strlen(symbol->name) + 1;
+            memcpy(names + offset, symbol->name, length);
+            offset += length;
+        }
+    }
+    for (i = 0; i < instruction_memory->length; i++) {
+        word = &instruction_memory->words[i];
+        if (word->ext) {
+            current = put_symbol(current, instruction_memory->base + i, offset);
+            length = strlen(word->ext) + 1;
+            memcpy(names + offset, word->ext, length);
+            offset += length;
+        } else if ((word->binary_code & ENCTYPE_MASK) == RELOCATABLE) {
+            put_u32(relocation, instruction_memory->base + i);
+            relocation += OBJECT_RELOCATION_SIZE;
+        }
+    }
+
+    buffer->length += total;
+}
+
+
+/* Appends a line of a label and an address, as used by the entries and the externals files */
+void append_symbol(bufptr buffer, const char *name, unsigned int address) {
+    reserve_buffer(buffer, strlen(name) + SYMBOL_NAME_WIDTH + NUMBER_LENGTH);
+    buffer->length += (size_t) sprintf(buffer->data + buffer->length, "%-*s %u\n", SYMBOL_NAME_WIDTH, name,
+                                       address);
+}
+
+
+/* Appends a string, without its terminating '\0' */
+void append_string(bufptr buffer, const char *string) {
+    size_t length = strlen(string);
+
+    reserve_buffer(buffer, length);
+    memcpy(buffer->data + buffer->length, string, length);
+    buffer->length += length;
+}
+
+
+/* Writes the words of a segment as little-endian 16 bit numbers. Returns the end of the words */
+static unsigned char *put_words(unsigned char *current, segptr memory) {
+    Word *word, *end = memory->words + memory->length;
+
+    for (word = memory->words; word < end; word++) {
+        put_u16(current, word->binary_code & WORD_MASK);
+        current += OBJECT_WORD_SIZE;
+    }
+
+    return current;
+}
+
+
+/* Writes an entry or a use of an external of a binary object. Returns the end of the symbol */
+static unsigned char *put_symbol(unsigned char *current, unsigned long address, unsigned long name_offset) {
+    put_u32(current, address);
+    put_u32(current + OBJECT_SYMBOL_SIZE / 2, name_offset);
+
+    return current + OBJECT_SYMBOL_SIZE;
+}
+
+
+/* Writes a little-endian 16 bit number */
+static void put_u16(unsigned char *bytes, unsigned int value) {
+    bytes[0] = (unsigned char) (value & 0xFF);
+    bytes[1] = (unsigned char) ((value >> 8) & 0xFF);
+}
+
+
+/* Writes a little-endian 32 bit number */
+static void put_u32(unsigned char *bytes, unsigned long value) {
+    bytes[0] = (unsigned char) (value & 0xFF);
+    bytes[1] = (unsigned char) ((value >> 8) & 0xFF);
+    bytes[2] = (unsigned char) ((value >> 16) & 0xFF);
+    bytes[3] = (unsigned char) ((value >> 24) & 0xFF);
+}
+
+
+/* Creates a file with the content of a buffer, using a single write. Returns 1 on success, else returns 0 */
+int write_buffer(bufptr buffer, const char *file_name) {
+    FILE *fd;
+    int written;
+
+    if (!(fd = fopen(file_name, "wb")))     /* the bytes are written as they are, also for a binary object */
+        return 0;
+
+    setvbuf(fd, NULL, _IONBF, 0);       /* the buffer is complete - no need for another copy */
+    written = (fwrite(buffer->data, 1, buffer->length, fd) == buffer->length);
+
+    return (fclose(fd) == 0 && written);
+}
+
+
+/* Creates the missing directories in the path of a file. Returns 1 on success, else returns 0 */
+int create_directories(const char *file_name) {
+    char *path, *separator;
+    int success = 1;
+
+    if (!(path = (char *) malloc(strlen(file_name) + 1)))
+        return 0;
+    strcpy(path, file_name);
+
+    /* every prefix which ends before a '/' is a directory */
+    for (separator = strchr(path + 1, '/'); separator && success; separator = strchr(separator + 1, '/')) {
+        *separator = '\0';
+        if (mkdir(path, DIRECTORY_MODE) && errno != EEXIST)
+            success = 0;
+        *separator = '/';
+    }
+
+    free(path);
+
+    return success;
+}
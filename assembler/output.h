@@ -0,0 +1,58 @@
+#ifndef PROJECT_OUTPUT_H
+#define PROJECT_OUTPUT_H
+
+#include "memory.h"
+
+
+/* The content of an output file - built in memory and written at once */
+typedef struct buffer *bufptr;
+typedef struct buffer {
+    char *data;
+    size_t length;                  /* Number of characters in the buffer */
+    size_t capacity;                /* Number of allocated characters */
+    aptr arena;                     /* The characters are allocated from this arena */
+} Buffer;
+
+
+/* Initialize an empty buffer */
+void init_buffer(bufptr buffer, aptr arena);
+
+
+/* Makes room for at least 'count' more characters at the end of a buffer */
+void reserve_buffer(bufptr buffer, size_t count);
+
+
+/* Appends the header line of an object file - the number of instruction words and of data words */
+void append_counts(bufptr buffer, unsigned int instructions, unsigned int data);
+
+
+/* Appends the words of a segment, 2 base-64 characters in a line for every word */
+void append_words(bufptr buffer, segptr memory);
+
+
+/* Appends 'count' words which are given by their bits, like 'append_words' */
+void append_codes(bufptr buffer, const uint16_t *codes, unsigned int count);
+
+
+/* Appends a binary object - the header, the words of the instructions and of the data, the entries,
+ * the uses of externals and the relocatable words, in the layout of 'object.h' */
+void append_object(bufptr buffer, tptr symbols_table, segptr data_memory, segptr instruction_memory);
+
+
+/* Appends a line of a label and an address, as used by the entries and the externals files */
+void append_symbol(bufptr buffer, const char *name, unsigned int address);
+
+
+/* Appends a string, without its terminating '\0' */
+void append_string(bufptr buffer, const char *string);
+
+
+/* Creates a file with the content of a buffer, using a single write. Returns 1 on success, else returns 0 */
+int write_buffer(bufptr buffer, const char *file_name);
+
+
+/* Creates the missing directories in the path of a file. Returns 1 on success, else returns 0 */
+int create_directories(const char *file_name);
+
+
+#endif
@@ -0,0 +1,440 @@
+/* This file is implementing the server mode of the assembler.
+ * A request is a line 'ASSEMBLE <length> [name]' followed by <length> bytes of source. It's answered by a line
+ * 'RESULT <status> <length>' followed by <length> bytes, which hold the .ob, .ent and .ext files and the errors -
+ * every one of them as a line '<section> <length>' followed by its content.
+ * The sources are assembled in memory by the library, and the lookup tables are static, so a request costs
+ * no process startup and no file I/O. A socket server serves every client on a thread of its own. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "server.h"
+#include "library.h"
+#include "output.h"
+
+
+#define HEADER_LENGTH 256
+#define MAX_SOURCE_LENGTH (256UL * 1024 * 1024)
+#define BACKLOG 64
+#define INITIAL_CLIENTS 16
+#define DEFAULT_NAME "source"
+#define OK_STATUS "ok"              /* Assembled without errors */
+#define ERROR_STATUS "error"        /* The source has errors, which are in the response */
+#define FAILED_STATUS "failed"      /* The request couldn't be served, the response is the reason */
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* Kinds of requests */
+typedef enum request_kind {
+    BAD_REQUEST, ASSEMBLE_REQUEST, QUIT_REQUEST, SHUTDOWN_REQUEST
+} RequestKind;
+
+
+/* The state of a socket server, shared by the threads of its clients */
+typedef struct server *srvptr;
+typedef struct server {
+    optptr options;
+    int *clients;                   /* Sockets of the connected clients */
+    unsigned int count;             /* Number of connected clients */
+    unsigned int capacity;          /* Number of allocated sockets */
+    unsigned int running;           /* Number of client threads which haven't finished yet */
+    int wakeup[2];                  /* A pipe which wakes the listening thread up to shut down */
+    pthread_mutex_t lock;
+    pthread_cond_t finished;        /* Signaled whenever a client thread finishes */
+} Server;
+
+
+/* A connected client, owned by its thread */
+typedef struct client {
+    srvptr server;
+    int socket;
+} Client;
+
+
+static int wakeup_pipe = -1;        /* The write end of the wakeup pipe of the server, for the signal handler */
+
+
+static RequestKind serve_request(FILE *in, FILE *out, optptr options);
+
+static int assemble_request(FILE *in, FILE *out, unsigned long length, char *name, optptr options);
+
+static void write_outputs(FILE *stream, resptr result, char *name, optptr options);
+
+static void write_section(FILE *stream, const char *section, const char *data, size_t length);
+
+static void write_response(FILE *out, const char *status, const char *body, size_t length);
+
+static void write_failure(FILE *out, const char *reason);
+
+static void start_client(srvptr server, int client);
+
+static void *serve_client(void *arg);
+
+static void remove_client(srvptr server, int client);
+
+static void wake_server(int pipe_end);
+
+static void stop_server(int number);
+
+static int server_error(const char *action, const char *path);
+
+
+/* Serves assembling requests on a Unix socket at 'path', a thread for every client,
+ * until SIGINT, SIGTERM or a 'SHUTDOWN' request. Returns 0 on a clean shutdown, else returns 1 */
+int serve_socket(const char *path, optptr options) {
+    struct sockaddr_un address;
+    struct sigaction action;
+    struct pollfd events[2];
+    struct stat info;
+    Server server;
+    int listener, socket_fd;
+    unsigned int i;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+        return server_error("use", path);
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if (!stat(path, &info) && S_ISSOCK(info.st_mode))
+        unlink(path);                   /* a socket left by a server which didn't shut down */
+    if ((listener = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return server_error("create", path);
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) || listen(listener, BACKLOG)) {
+        close(listener);
+        return server_error("listen on", path);
+    }
+    if (pipe(server.wakeup)) {
+        close(listener);
+        unlink(path);
+        return server_error("create a pipe for", path);
+    }
+    fcntl(server.wakeup[1], F_SETFL, O_NONBLOCK);       /* a signal handler never blocks on a full pipe */
+
+    server.options = options;
+    server.clients = NULL;
+    server.count = server.capacity = server.running = 0;
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.finished, NULL);
+
+    wakeup_pipe = server.wakeup[1];
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = stop_server;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_handler = SIG_IGN;            /* a client which disconnects early isn't an error of the server */
+    sigaction(SIGPIPE, &action, NULL);
+
+    printf("Serving on '%s'.\n", path);
+    fflush(stdout);
+
+    for (;;) {
+        events[0].fd = listener;
+        events[0].events = POLLIN;
+        events[1].fd = server.wakeup[0];
+        events[1].events = POLLIN;
+        if (poll(events, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (events[1].revents)
+            break;
+        if ((events[0].revents & POLLIN) && (socket_fd = accept(listener, NULL, NULL)) >= 0)
+            start_client(&server, socket_fd);
+    }
+
+    close(listener);
+    unlink(path);
+
+    /* the requests in progress are completed, and then the clients see the end of their connections */
+    pthread_mutex_lock(&server.lock);
+    for (i = 0; i < server.count; i++)
+        shutdown(server.clients[i], SHUT_RD);
+    while (server.running)
+        pthread_cond_wait(&server.finished, &server.lock);
+    pthread_mutex_unlock(&server.lock);
+
+    wakeup_pipe = -1;
+    close(server.wakeup[0]);
+    close(server.wakeup[1]);
+    free(server.clients);
+    pthread_mutex_destroy(&server.lock);
+    pthread_cond_destroy(&server.finished);
+
+    printf("Server stopped.\n");
+
+    return 0;
+}
+
+
+/* Serves the assembling requests read from 'in' one by one, until the end of 'in' or a 'QUIT' or 'SHUTDOWN' request.
+ * The responses are written to 'out'. Returns 0 */
+int serve_stream(FILE *in, FILE *out, optptr options) {
+    while (serve_request(in, out, options) == ASSEMBLE_REQUEST);
+
+    return 0;
+}
+
+
+/* Reads a request and answers it. Returns the kind of the request, or BAD_REQUEST if the connection should be closed */
+static RequestKind serve_request(FILE *in, FILE *out, optptr options) {
+    char header[HEADER_LENGTH], command[HEADER_LENGTH], name[HEADER_LENGTH];
+    unsigned long length = 0;
+    int fields;
+
+    if (!fgets(header, HEADER_LENGTH, in))
+        return QUIT_REQUEST;
+
+    strcpy(name, DEFAULT_NAME);
+    fields = sscanf(header, "%s %lu %s", command, &length, name);
+    if (fields == 1 && !strcmp(command, "QUIT"))
+        return QUIT_REQUEST;
+    if (fields == 1 && !strcmp(command, "SHUTDOWN"))
+        return SHUTDOWN_REQUEST;
+
+    if (!strchr(header, '\n') || fields < 2 || strcmp(command, "ASSEMBLE") || length > MAX_SOURCE_LENGTH) {
+        write_failure(out, "invalid request.\n");
+        return BAD_REQUEST;
+    }
+
+    return assemble_request(in, out, length, name, options) ? ASSEMBLE_REQUEST : BAD_REQUEST;
+}
+
+
+/* Reads the source of a request, assembles it and writes the response.
+ * Returns 1 if the next request can be read, or 0 if the source couldn't be read */
+static int assemble_request(FILE *in, FILE *out, unsigned long length, char *name, optptr options) {
+    AssemblyResult result;
+    FILE *stream;
+    char *text, *body = NULL;
+    size_t body_length = 0;
+    int run;
+
+    if (!(text = (char *) malloc(length + 1))) {
+        write_failure(out, "out of memory.\n");
+        return FALSE;
+    }
+    if (fread(text, 1, length, in) != length) {
+        free(text);
+        return FALSE;
+    }
+
+    run = assemble_buffer(text, length, options, &result);
+    free(text);
+    if (run < 0) {
+        write_failure(out, "out of memory.\n");
+        return TRUE;
+    }
+
+    if (!(stream = open_memstream(&body, &body_length))) {
+        free_result(&result);
+        write_failure(out, "out of memory.\n");
+        return TRUE;
+    }
+    write_outputs(stream, &result, name, options);
+    fclose(stream);
+
+    write_response(out, run ? OK_STATUS : ERROR_STATUS, body, body_length);
+
+    free(body);
+    free_result(&result);
+
+    return TRUE;
+}
+
+
+/* Writes the sections of a response - the output files, as they would be written by the assembler, and the errors */
+static void write_outputs(FILE *stream, resptr result, char *name, optptr options) {
+    Buffer ob, ent, ext;
+    Diagnostics diagnostics;
+    FILE *errors_stream;
+    char *errors = NULL;
+    size_t errors_length = 0;
+    unsigned int i;
+
+    init_buffer(&ob, result->arena);
+    init_buffer(&ent, result->arena);
+    init_buffer(&ext, result->arena);
+    if (result->code) {                 /* the outputs exist once the first pass succeeds */
+        append_counts(&ob, result->code_length, result->data_length);
+        append_codes(&ob, result->code, result->code_length);
+        append_codes(&ob, result->data, result->data_length);
+    }
+    for (i = 0; i < result->entries_count; i++)
+        append_symbol(&ent, result->entries[i].name, result->entries[i].address);
+    for (i = 0; i < result->externals_count; i++)
+        append_symbol(&ext, result->externals[i].name, result->externals[i].address);
+
+    /* the errors are printed like the errors of a file */
+    init_diagnostics(&diagnostics, options->max_errors, result->arena);
+    diagnostics.list = result->diagnostics;
+    diagnostics.count = diagnostics.capacity = result->diagnostics_count;
+    if ((errors_stream = open_memstream(&errors, &errors_length))) {
+        print_diagnostics(&diagnostics, errors_stream, name, options->error_format);
+        fclose(errors_stream);
+    }
+
+    write_section(stream, "OB", ob.data, ob.length);
+    write_section(stream, "ENT", ent.data, ent.length);
+    write_section(stream, "EXT", ext.data, ext.length);
+    write_section(stream, "ERRORS", errors, errors_length);
+
+    free(errors);
+}
+
+
+/* Writes a section of a response - a line of its name and its length, followed by its content */
+static void write_section(FILE *stream, const char *section, const char *data, size_t length) {
+    fprintf(stream, "%s %lu\n", section, (unsigned long) length);
+    if (length)
+        fwrite(data, 1, length, stream);
+}
+
+
+/* Writes a response - a line of its status and its length, followed by its body */
+static void write_response(FILE *out, const char *status, const char *body, size_t length) {
+    fprintf(out, "RESULT %s %lu\n", status, (unsigned long) length);
+    if (length)
+        fwrite(body, 1, length, out);
+    fflush(out);
+}
+
+
+/* Writes the response of a request which couldn't be served */
+static void write_failure(FILE *out, const char *reason) {
+    write_response(out, FAILED_STATUS, reason, strlen(reason));
+}
+
+
+/* Registers the socket of a connected client and starts its thread. The socket is closed if it can't be served */
+static void start_client(srvptr server, int client) {
+    pthread_attr_t attributes;
+    pthread_t thread;
+    Client *state;
+    int *clients, started = FALSE;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->count == server->capacity) {
+        unsigned int capacity = server->capacity ? server->capacity * 2 : INITIAL_CLIENTS;
+        if (!(clients = (int *) realloc(server->clients, capacity * sizeof(int)))) {
+            pthread_mutex_unlock(&server->lock);
+            close(client);
+            return;
+        }
+        server->clients = clients;
+        server->capacity = capacity;
+    }
+    server->clients[server->count++] = client;
+    server->running++;
+    pthread_mutex_unlock(&server->lock);
+
+    if ((state = (Client *) malloc(sizeof(Client)))) {
+        state->server = server;
+        state->socket = client;
+        pthread_attr_init(&attributes);
+        pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+        started = !pthread_create(&thread, &attributes, serve_client, state);
+        pthread_attr_destroy(&attributes);
+    }
+
+    if (!started) {
+        free(state);
+        remove_client(server, client);
+        close(client);
+        pthread_mutex_lock(&server->lock);
+        server->running--;
+        pthread_mutex_unlock(&server->lock);
+    }
+}
+
+
+/* The thread of a client - serves its requests until it disconnects */
+static void *serve_client(void *arg) {
+    Client *client = (Client *) arg;
+    srvptr server = client->server;
+    RequestKind kind = BAD_REQUEST;
+    FILE *in, *out = NULL;
+    int copy = dup(client->socket);
+
+    in = fdopen(client->socket, "r");
+    if (copy >= 0 && !(out = fdopen(copy, "w")))
+        close(copy);
+    if (in && out)
+        while ((kind = serve_request(in, out, server->options)) == ASSEMBLE_REQUEST);
+
+    if (kind == SHUTDOWN_REQUEST)
+        wake_server(server->wakeup[1]);
+
+    remove_client(server, client->socket);      /* before it's closed, so it isn't shut down once it's reused */
+    if (in)
+        fclose(in);
+    else
+        close(client->socket);
+    if (out)
+        fclose(out);
+    free(client);
+
+    pthread_mutex_lock(&server->lock);
+    server->running--;
+    pthread_cond_signal(&server->finished);
+    pthread_mutex_unlock(&server->lock);
+
+    return NULL;
+}
+
+
+/* Removes the socket of a client from the connected clients */
+static void remove_client(srvptr server, int client) {
+    unsigned int i;
+
+    pthread_mutex_lock(&server->lock);
+    for (i = 0; i < server->count; i++) {
+        if (server->clients[i] == client) {
+            server->clients[i] = server->clients[--server->count];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&server->lock);
+}
+
+
+/* Writes a byte to the wakeup pipe, which wakes the listening thread up to shut down. Safe in a signal handler.
+ * The pipe doesn't block, and a full pipe already holds a byte which wakes the thread up, so it isn't retried */
+static void wake_server(int pipe_end) {
+    int saved = errno;
+
+    while (write(pipe_end, "", 1) < 0 && errno == EINTR)
+        ;
+    errno = saved;
+}
+
+
+/* The handler of SIGINT and SIGTERM - wakes the listening thread up to shut down */
+static void stop_server(int number) {
+    if (wakeup_pipe >= 0)
+        wake_server(wakeup_pipe);
+}
+
+
+/* Printing a message when the server can't start */
+static int server_error(const char *action, const char *path) {
+    fprintf(stderr, "*** ERROR: failed to %s the socket '%s' *** \n", action, path);
+    return 1;
+}
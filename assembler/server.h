@@ -0,0 +1,21 @@
+#ifndef PROJECT_SERVER_H
+#define PROJECT_SERVER_H
+
+#include <stdio.h>
+#include "assemble.h"
+
+
+#define STDIN_SERVER "-"            /* The server path which serves the standard input */
+
+
+/* Serves assembling requests on a Unix socket at 'path', a thread for every client,
+ * until SIGINT, SIGTERM or a 'SHUTDOWN' request. Returns 0 on a clean shutdown, else returns 1 */
+int serve_socket(const char *path, optptr options);
+
+
+/* Serves the assembling requests read from 'in' one by one, until the end of 'in' or a 'QUIT' or 'SHUTDOWN' request.
+ * The responses are written to 'out'. Returns 0 */
+int serve_stream(FILE *in, FILE *out, optptr options);
+
+
+#endif
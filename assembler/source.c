@@ -0,0 +1,117 @@
+/* This file is implementing the input of the assembler.
+ * A source file is read into memory once, and its lines are terminated in place as they are read,
+ * so the passes go over the text without copying its lines. */
+
+#include <stdio.h>
+#include <string.h>
+#include "source.h"
+
+
+#define SPARE_BYTES 2       /* room for the terminating '\0' and for detecting the end of the file */
+
+
+static void init_position(srcptr source, aptr arena);
+
+
+/* Reads a whole file into memory. Returns NULL if the file can't be read */
+srcptr read_source(char *file_name, aptr arena) {
+    FILE *fd;
+    srcptr source;
+    size_t capacity, count;
+    long size;
+
+    if (!(fd = fopen(file_name, "rb")))
+        return NULL;
+
+    if (fseek(fd, 0, SEEK_END) || (size = ftell(fd)) < 0 || fseek(fd, 0, SEEK_SET))
+        size = 0;
+
+    source = (srcptr) arena_alloc(arena, sizeof(Source));
+    capacity = (size_t) size + SPARE_BYTES;
+    source->text = (char *) arena_alloc(arena, capacity);
+    source->length = 0;
+
+    /* a single read when the size of the file is known, the buffer grows only for streams */
+    while ((count = fread(source->text + source->length, 1, capacity - source->length - 1, fd)) > 0) {
+        source->length += count;
+        if (capacity - source->length == 1) {
+            source->text = (char *) arena_grow(arena, source->text, source->length, capacity * 2);
+            capacity *= 2;
+        }
+    }
+    source->text[source->length] = '\0';
+
+    if (ferror(fd)) {
+        fclose(fd);
+        return NULL;
+    }
+    fclose(fd);
+
+    init_position(source, arena);
+
+    return source;
+}
+
+
+/* Copies 'length' characters of a source which is already in memory */
+srcptr new_source(const char *text, size_t length, aptr arena) {
+    srcptr source = (srcptr) arena_alloc(arena, sizeof(Source));
+
+    source->text = (char *) arena_alloc(arena, length + 1);    /* a copy, as the lines are terminated in place */
+    memcpy(source->text, text, length);
+    source->text[length] = '\0';
+    source->length = length;
+
+    init_position(source, arena);
+
+    return source;
+}
+
+
+/* Makes a source of a text which was allocated from the arena, without copying it.
+ * The text needs room for a '\0' after its last character */
+srcptr text_source(char *text, size_t length, aptr arena) {
+    srcptr source = (srcptr) arena_alloc(arena, sizeof(Source));
+
+    source->text = text;
+    source->text[length] = '\0';
+    source->length = length;
+
+    init_position(source, arena);
+
+    return source;
+}
+
+
+/* Terminates the next line of the source and returns it, or returns NULL at the end of the source */
+char *next_line(srcptr source, unsigned int *length) {
+    char *line, *end;
+
+    if (source->position >= source->length)
+        return NULL;
+
+    line = source->text + source->position;
+    if ((end = (char *) memchr(line, '\n', source->length - source->position)))
+        *end = '\0';
+    else
+        end = source->text + source->length;
+
+    source->position = (size_t) (end - source->text) + 1;
+    *length = (unsigned int) (end - line);
+
+    return line;
+}
+
+
+/* Returns the line of the original file of a line, lines are counted from 1 */
+unsigned int get_origin(srcptr source, unsigned int line) {
+    return source->origins ? source->origins[line - 1] : line;
+}
+
+
+/* Initialize the source to be read from its first line */
+static void init_position(srcptr source, aptr arena) {
+    source->position = 0;
+    source->origins = NULL;
+    source->arena = arena;
+}
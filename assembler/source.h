@@ -0,0 +1,40 @@
+#ifndef PROJECT_SOURCE_H
+#define PROJECT_SOURCE_H
+
+#include <stddef.h>
+#include "arena.h"
+
+
+/* A source file read into memory, which is read line by line */
+typedef struct source *srcptr;
+typedef struct source {
+    char *text;                     /* The content of the file, every line is terminated by '\0' */
+    size_t length;                  /* Number of characters in 'text' */
+    size_t position;                /* Offset of the next line to read */
+    unsigned int *origins;          /* Line in the original file of every line, NULL if the lines weren't moved */
+    aptr arena;                     /* The text is allocated from this arena */
+} Source;
+
+
+/* Reads a whole file into memory. Returns NULL if the file can't be read */
+srcptr read_source(char *file_name, aptr arena);
+
+
+/* Copies 'length' characters of a source which is already in memory */
+srcptr new_source(const char *text, size_t length, aptr arena);
+
+
+/* Makes a source of a text which was allocated from the arena, without copying it.
+ * The text needs room for a '\0' after its last character */
+srcptr text_source(char *text, size_t length, aptr arena);
+
+
+/* Terminates the next line of the source and returns it, or returns NULL at the end of the source */
+char *next_line(srcptr source, unsigned int *length);
+
+
+/* Returns the line of the original file of a line, lines are counted from 1 */
+unsigned int get_origin(srcptr source, unsigned int line);
+
+
+#endif
@@ -0,0 +1,106 @@
+/* This file is implementing the statistics of the assembler.
+ * The counters are kept by the structures they count and collected once a file is done,
+ * the phases are timed only when statistics were requested. */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+
+#define NANOSECONDS 1e9
+
+
+static double get_time(void);
+
+
+/* The names of the phases, by their order in 'StatsPhase' */
+static const char *phase_names[] = {"first_pass", "second_pass", "create_ob", "create_ent", "create_ext"};
+
+
+/* Initialize empty statistics */
+void init_stats(statptr stats) {
+    memset(stats, 0, sizeof(Stats));
+}
+
+
+/* Returns the time a phase starts at, if statistics are collected. Returns 0 if 'stats' is NULL */
+double start_phase(statptr stats) {
+    return stats ? get_time() : 0;
+}
+
+
+/* Adds the time since 'start' to a phase. Does nothing if 'stats' is NULL */
+void end_phase(statptr stats, StatsPhase phase, double start) {
+    if (stats)
+        stats->seconds[phase] += get_time() - start;
+}
+
+
+/* Adds the statistics of 'from' to 'to' */
+void merge_stats(statptr to, statptr from) {
+    int i;
+
+    for (i = 0; i < TOTAL_PHASES; i++)
+        to->seconds[i] += from->seconds[i];
+
+    to->files += from->files;
+    to->lines += from->lines;
+    to->symbols += from->symbols;
+    to->code_words += from->code_words;
+    to->data_words += from->data_words;
+    to->searches += from->searches;
+    to->comparisons += from->comparisons;
+    to->allocations += from->allocations;
+    to->allocated += from->allocated;
+    to->output_bytes += from->output_bytes;
+    to->cache_hits += from->cache_hits;
+    to->cache_misses += from->cache_misses;
+}
+
+
+/* Prints the statistics as text or as a single JSON line */
+void print_stats(statptr stats, FILE *out, DiagnosticsFormat format) {
+    int i;
+
+    if (format == JSON_FORMAT) {
+        fprintf(out, "{\"files\":%lu,\"lines\":%lu,\"symbols\":%lu,\"code_words\":%lu,\"data_words\":%lu,"
+                     "\"searches\":%lu,\"comparisons\":%lu,\"allocations\":%lu,\"allocated_bytes\":%lu,"
+                     "\"output_bytes\":%lu,\"cache_hits\":%lu,\"cache_misses\":%lu,\"seconds\":{",
+                stats->files, stats->lines, stats->symbols, stats->code_words, stats->data_words, stats->searches,
+                stats->comparisons, stats->allocations, (unsigned long) stats->allocated,
+                (unsigned long) stats->output_bytes, stats->cache_hits, stats->cache_misses);
+        for (i = 0; i < TOTAL_PHASES; i++)
+            fprintf(out, "%s\"%s\":%.6f", i ? "," : "", phase_names[i], stats->seconds[i]);
+        fprintf(out, "}}\n");
+        return;
+    }
+
+    fprintf(out, "Statistics:\n");
+    fprintf(out, "  %-18s %lu\n", "files", stats->files);
+    fprintf(out, "  %-18s %lu\n", "lines", stats->lines);
+    fprintf(out, "  %-18s %lu\n", "symbols", stats->symbols);
+    fprintf(out, "  %-18s %lu\n", "code words", stats->code_words);
+    fprintf(out, "  %-18s %lu\n", "data words", stats->data_words);
+    fprintf(out, "  %-18s %lu\n", "symbol searches", stats->searches);
+    fprintf(out, "  %-18s %lu\n", "name comparisons", stats->comparisons);
+    fprintf(out, "  %-18s %lu\n", "allocations", stats->allocations);
+    fprintf(out, "  %-18s %lu\n", "allocated bytes", (unsigned long) stats->allocated);
+    fprintf(out, "  %-18s %lu\n", "output bytes", (unsigned long) stats->output_bytes);
+    fprintf(out, "  %-18s %lu\n", "cache hits", stats->cache_hits);
+    fprintf(out, "  %-18s %lu\n", "cache misses", stats->cache_misses);
+    for (i = 0; i < TOTAL_PHASES; i++)
+        fprintf(out, "  %-18s %.6f s\n", phase_names[i], stats->seconds[i]);
+}
+
+
+/* Returns the time in seconds from an arbitrary point */
+static double get_time(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double) now.tv_sec + (double) now.tv_nsec / NANOSECONDS;
+}
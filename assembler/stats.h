@@ -0,0 +1,54 @@
+#ifndef PROJECT_STATS_H
+#define PROJECT_STATS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "diagnostics.h"
+
+
+/* The timed phases of an assembly */
+typedef enum stats_phase {
+    FIRST_PASS_PHASE, SECOND_PASS_PHASE, OB_PHASE, ENT_PHASE, EXT_PHASE, TOTAL_PHASES
+} StatsPhase;
+
+
+/* Statistics of assembled files - summed over all the files of a run */
+typedef struct stats *statptr;
+typedef struct stats {
+    double seconds[TOTAL_PHASES];   /* Wall time of every phase */
+    unsigned long files;
+    unsigned long lines;
+    unsigned long symbols;
+    unsigned long code_words;
+    unsigned long data_words;
+    unsigned long searches;         /* Number of symbol lookups */
+    unsigned long comparisons;      /* Number of names compared by the symbol lookups */
+    unsigned long allocations;      /* Number of arena allocations */
+    size_t allocated;               /* Number of bytes allocated from the arenas */
+    size_t output_bytes;            /* Number of bytes written to the output files */
+    unsigned long cache_hits;       /* Number of files restored from the cache */
+    unsigned long cache_misses;     /* Number of files assembled although there's a cache */
+} Stats;
+
+
+/* Initialize empty statistics */
+void init_stats(statptr stats);
+
+
+/* Returns the time a phase starts at, if statistics are collected. Returns 0 if 'stats' is NULL */
+double start_phase(statptr stats);
+
+
+/* Adds the time since 'start' to a phase. Does nothing if 'stats' is NULL */
+void end_phase(statptr stats, StatsPhase phase, double start);
+
+
+/* Adds the statistics of 'from' to 'to' */
+void merge_stats(statptr to, statptr from);
+
+
+/* Prints the statistics as text or as a single JSON line */
+void print_stats(statptr stats, FILE *out, DiagnosticsFormat format);
+
+
+#endif
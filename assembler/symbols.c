@@ -7,76 +7,52 @@
 #include <string.h>
 #include <ctype.h>
 #include "symbols.h"
+#include "keywords.h"
 
 
+#define INITIAL_TABLE_SIZE 64        /* Must be a power of 2 */
+#define LOAD_FACTOR 2                /* The table grows when it is half full */
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
 enum {
     FALSE, TRUE
 };
 
-static int allocate_error(char *func);
-
-static char *skip_spaces(char *address);
-
-
-/* Checks if there's a label for a specific instruction */
-int is_label(char *instruction) {
-    int i, length;
-
-    instruction = skip_spaces(instruction);
-
-    for (i = 0, length = 0; instruction[i] != ':' && instruction[i] != '\0'; i++) {
-        if (!isalnum(instruction[i]) || isspace(instruction[i]))
-            return FALSE;
-        length++;
-    }
-    if (instruction[i] == ':' && length <= MAX_LABEL_LENGTH + 1) {
-        return TRUE;
-    }
-
-    return FALSE;
-}
-
-
-/* Returns the name of the label as a string. Assuming the instruction has a valid label. */
-char *get_label_name(char *instruction) {
-    unsigned int i;
-    char *label;
+static sptr *find_slot(tptr table, const char *name, unsigned int length);
 
-    instruction = skip_spaces(instruction);
+static void count_search(tptr table, const char *name, unsigned int length, sptr *slot);
 
-    for (i = 0; instruction[i] != ':'; i++);
+static void grow_table(tptr table);
 
-    if (!(label = (char *) malloc((i * sizeof(char)) + 1)))
-        exit(allocate_error("get_label_name"));
+static unsigned long hash_name(const char *name, unsigned int length);
 
-    strncpy(label, instruction, i);
-    label[i] = '\0';
 
-    return label;
-}
-
-
-/* Returns the length of the label. Assuming there is a valid label. */
-int get_label_length(const char *instruction) {
-    int i, length;
+/* Create a new empty symbols table */
+tptr new_symbols_table(aptr arena) {
+    tptr table = (tptr) arena_alloc(arena, sizeof(SymbolsTable));
 
-    for (i = 0, length = 0; instruction[i] != ':'; i++, length++);
+    table->slots = (sptr *) arena_calloc(arena, INITIAL_TABLE_SIZE * sizeof(sptr));
+    table->arena = arena;
+    table->size = INITIAL_TABLE_SIZE;
+    table->count = 0;
+    table->head = NULL;
+    table->tail = NULL;
+    table->counting = FALSE;
+    table->searches = 0;
+    table->comparisons = 0;
 
-    return length;
+    return table;
 }
 
 
 /* Create a new symbol for the symbol table */
-sptr new_symbol(char *name, unsigned int value, SymbolType type) {
+sptr new_symbol(char *name, unsigned int value, SymbolType type, aptr arena) {
     sptr new;
-    if (!name || is_keyword(name)) {
-        if (is_keyword(name))
-            printf("Failed to create symbol - label name is a keyword.\n");
+    if (!name || is_keyword(name))
         return NULL;
-    }
 
-    if (!(new = (sptr) malloc(sizeof(Symbol))))
-        exit(allocate_error("new_symbol"));
+    new = (sptr) arena_alloc(arena, sizeof(Symbol));
 
     new->name = name;
     new->value = value;
@@ -89,65 +65,64 @@ sptr new_symbol(char *name, unsigned int value, SymbolType type) {
 
 
 /* Adds a new symbol to the symbol table. Returns 1 on success, else returns 0. */
-sptr add_symbol(sptr head, sptr new) {
-    sptr current;
+int add_symbol(tptr table, sptr new) {
+    sptr *slot;
 
-    if (!new)
-        return NULL;
+    if (!table || !new)
+        return FALSE;
 
-    if (!head)
-        return new;
+    if (*(slot = find_slot(table, new->name, (unsigned int) strlen(new->name))))
+        return FALSE;
 
-    if (search_symbol(head, new->name)) {
-        free(new);
-        printf("Failed to add symbol - label name already exists.\n");
-        delete_symbols_table(head);
-        return NULL;
-    }
+    *slot = new;
+    table->count++;
 
-    for (current = head; current->next; current = current->next);
+    if (table->tail) {
+        table->tail->next = new;
+        new->prev = table->tail;
+    } else
+        table->head = new;
+    table->tail = new;
 
-    current->next = new;
-    new->prev = current;
+    if (table->count * LOAD_FACTOR >= table->size)
+        grow_table(table);
 
-    return head;
+    return TRUE;
 }
 
 
-/* Delete all the symbols from the table */
-void delete_symbols_table(sptr head) {
-    sptr temp;
-
-    if (head) {
-        for (temp = head->next; temp; temp = temp->next) {
-            free(head->name);
-            free(head);
-            head = temp;
-        }
-        free(head->name);
-        free(head);
-    }
-}
+/* Update all data symbols by adding the instruction counter to their values. */
+void update_symbols(tptr table, const unsigned int *instruction_counter) {
+    sptr head;
 
+    if (!table)
+        return;
 
-/* Update all data symbols by adding the instruction counter to their values. */
-void update_symbols(sptr head, const unsigned int *instruction_counter) {
-    while (head) {
+    for (head = table->head; head; head = head->next) {
         if (head->type == DATA_SYMBOL)
             head->value += *instruction_counter;
-        head = head->next;
     }
 }
 
 
 /* Searching for a symbol with a specific name in the symbols table. */
-sptr search_symbol(sptr head, char *name) {
-    if (name) {
-        while (head) {
-            if (!strcmp(name, head->name))
-                return head;
-            head = head->next;
-        }
+sptr search_symbol(tptr table, char *name) {
+    if (name)
+        return find_symbol(table, name, (unsigned int) strlen(name));
+
+    return NULL;
+}
+
+
+/* Searching for a symbol by the first 'length' characters of a name, which doesn't have to end with '\0' */
+sptr find_symbol(tptr table, const char *name, unsigned int length) {
+    sptr *slot;
+
+    if (name && table) {
+        slot = find_slot(table, name, length);
+        if (table->counting)
+            count_search(table, name, length, slot);
+        return *slot;
     }
 
     return NULL;
@@ -155,40 +130,65 @@ sptr search_symbol(sptr head, char *name) {
 
 
 /* Set the symbol type of a given symbol to 'entry'. */
-void set_entry(sptr head, char *name) {
-    if (name) {
-        sptr temp = search_symbol(head, name);
-        if (temp)
-            temp->type = ENTRY_SYMBOL;
-    }
+void set_entry(tptr table, const char *name, unsigned int length) {
+    sptr temp = find_symbol(table, name, length);
+
+    if (temp)
+        temp->type = ENTRY_SYMBOL;
 }
 
 
 /* Checks is a given string is an assembly keyword. */
 int is_keyword(char *str) {
-    int i;
-    char *keywords[] = {"data", "string", "entry", "extern", "mov", "cmp", "add", "sub", "not", "clr", "lea", "inc",
-                        "dec", "jmp", "bne", "red", "prn", "jsr", "rts", "stop", "r7", "r6", "r5", "r4", "r3", "r2",
-                        "r1", "r0"};
-    for (i = 0; i < TOTAL_KEYWORDS; i++) {
-        if (!strcmp(str, keywords[i]))
-            return TRUE;
+    return (find_keyword(str, (unsigned int) strlen(str)).kind != NO_KEYWORD);
+}
+
+
+/* Returns the slot of the symbol with the given name, or the empty slot where it should be inserted */
+static sptr *find_slot(tptr table, const char *name, unsigned int length) {
+    unsigned long mask = table->size - 1;
+    unsigned long i = hash_name(name, length) & mask;
+
+    for (; table->slots[i]; i = (i + 1) & mask) {
+        if (!strncmp(name, table->slots[i]->name, length) && !table->slots[i]->name[length])
+            break;
     }
-    return FALSE;
+
+    return &table->slots[i];
 }
 
 
-/* Returns a pointer to the next non-space character */
-static char *skip_spaces(char *address) {
-    while (isspace(*address))
-        address++;
-    return address;
+/* Counts a lookup which ended at 'slot'. The names compared are the full slots from the slot of the hash,
+ * so they are counted from the distance of the slots instead of on every probe of the lookups */
+static void count_search(tptr table, const char *name, unsigned int length, sptr *slot) {
+    unsigned long mask = table->size - 1;
+    unsigned long start = hash_name(name, length) & mask, end = (unsigned long) (slot - table->slots);
+
+    table->searches++;
+    table->comparisons += ((end - start) & mask) + (*slot != NULL);
 }
 
 
-/* Memory allocation fail */
-static int allocate_error(char *func) {
-    fprintf(stderr, "*** ERROR: In function '%s' - failed to allocate memory. *** \n", func);
-    return 1;
+/* Doubles the number of slots and re-inserts all the symbols */
+static void grow_table(tptr table) {
+    sptr current;
+
+    table->slots = (sptr *) arena_calloc(table->arena, table->size * 2 * sizeof(sptr));
+    table->size *= 2;
+
+    for (current = table->head; current; current = current->next)
+        *find_slot(table, current->name, (unsigned int) strlen(current->name)) = current;
 }
 
+
+/* FNV-1a hash of the first 'length' characters of a label name */
+static unsigned long hash_name(const char *name, unsigned int length) {
+    unsigned long hash = FNV_OFFSET_BASIS;
+
+    while (length--) {
+        hash ^= (unsigned char) *name++;
+        hash = (hash * FNV_PRIME) & 0xffffffffUL;
+    }
+
+    return hash;
+}
@@ -1,13 +1,14 @@
 #ifndef PROJECT_SYMBOLS_H
 #define PROJECT_SYMBOLS_H
 
+#include "arena.h"
+
 #define MAX_LABEL_LENGTH 31         /* Maximum length for a label name */
-#define TOTAL_KEYWORDS 28           /* Number of supported keywords */
 
 
 /* Supported types of symbols */
 typedef enum symbol_type {
-    CODE_SYMBOL = -99, DATA_SYMBOL, EXTERN_SYMBOL, ENTRY_SYMBOL
+    CODE_SYMBOL = -99, DATA_SYMBOL, EXTERN_SYMBOL, ENTRY_SYMBOL, MACRO_SYMBOL
 } SymbolType;
 
 
@@ -22,40 +23,48 @@ typedef struct symbol {
 } Symbol;
 
 
-/* Create a new symbol for the symbol table */
-sptr new_symbol(char *name, unsigned int value, SymbolType type);
-
-
-/* Adds a new symbol to the symbol table. Returns 1 on success, else returns 0 */
-sptr add_symbol(sptr head, sptr new);
-
+/* The symbols table - symbols are kept in a linked list by order of insertion,
+ * and indexed by name in an open addressing hash table */
+typedef struct symbols_table *tptr;
+typedef struct symbols_table {
+    sptr *slots;
+    unsigned int size;              /* Number of slots - always a power of 2 */
+    unsigned int count;             /* Number of symbols in the table */
+    sptr head;
+    sptr tail;
+    aptr arena;                     /* The symbols and the slots are allocated from this arena */
+    int counting;                   /* Count the lookups, only when the statistics are collected */
+    unsigned long searches;         /* Number of lookups, for the statistics */
+    unsigned long comparisons;      /* Number of names compared by the lookups, for the statistics */
+} SymbolsTable;
 
-/* Checks if there's a label for a specific instruction */
-int is_label(char *instruction);
 
+/* Create a new empty symbols table */
+tptr new_symbols_table(aptr arena);
 
-/* Returns the length of the label. Assuming there is a valid label */
-int get_label_length(const char *instruction);
 
+/* Create a new symbol for the symbol table. Returns NULL if the name is missing or is a keyword */
+sptr new_symbol(char *name, unsigned int value, SymbolType type, aptr arena);
 
-/* Returns the name of the label as a string. Assuming the instruction has a valid label */
-char *get_label_name(char *instruction);
 
-
-/* Delete all the symbols from the table */
-void delete_symbols_table(sptr head);
+/* Adds a new symbol to the symbol table. Returns 1 on success, else returns 0 */
+int add_symbol(tptr table, sptr new);
 
 
 /* Update all data symbols by adding the instruction counter to their values */
-void update_symbols(sptr head, const unsigned int *instruction_counter);
+void update_symbols(tptr table, const unsigned int *instruction_counter);
 
 
 /* Searching for a symbol with a specific name in the symbols table */
-sptr search_symbol(sptr head, char *name);
+sptr search_symbol(tptr table, char *name);
+
+
+/* Searching for a symbol by the first 'length' characters of a name, which doesn't have to end with '\0' */
+sptr find_symbol(tptr table, const char *name, unsigned int length);
 
 
 /* Set the symbol type of a given symbol to 'entry' */
-void set_entry(sptr head, char *name);
+void set_entry(tptr table, const char *name, unsigned int length);
 
 
 /* Checks is a given string is an assembly keyword. */
@@ -0,0 +1,11 @@
+; Negative immediates, externals, entries and data, which the disassembler prints back as a source
+.extern OUT
+.entry MAIN
+MAIN:	prn -5
+	cmp -512, @r1
+	mov OUT, @r3
+	add 7, NUMS
+	jmp OUT
+	bne MAIN
+	stop
+NUMS:	.data -1, 5, -2048
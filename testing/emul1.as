@@ -0,0 +1,8 @@
+; Prints the letters A to C with a loop, and a new line
+MAIN:	mov 65, @r1
+LOOP:	prn @r1
+	inc @r1
+	cmp @r1, 68
+	bne LOOP
+	prn 10
+	stop
@@ -0,0 +1,7 @@
+; Copies the standard input to the standard output
+LOOP:	red @r1
+	cmp @r1, -1
+	bne OUT
+	stop
+OUT:	prn @r1
+	jmp LOOP
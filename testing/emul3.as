@@ -0,0 +1,2 @@
+; Never stops, so it runs until the limit of instructions
+LOOP:	jmp LOOP
@@ -0,0 +1,6 @@
+; args: --max-line-length 40
+MAIN:	mov @r1, @r2
+	prn -5
+LONG:	.data 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12
+	stop
+; this comment line is much longer than the limit of forty characters
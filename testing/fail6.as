@@ -0,0 +1,9 @@
+; A macro used before its definition isn't expanded, and the errors of an expanded body are at their lines
+	show
+mcro show
+	prn @r1
+	prn ,
+endmcro
+	show
+	show
+	stop
@@ -0,0 +1,18 @@
+; Macro names follow the rules of labels and can be defined once, their errors are in order with the others
+mcro 1loop
+	stop
+endmcro
+	prn ,
+mcro mov
+	stop
+endmcro
+mcro done
+	stop
+endmcro
+mcro done
+	rts
+endmcro
+	done
+	stop
+mcro open
+	stop
@@ -0,0 +1,132 @@
+/* This file is implementing the test of the library of the assembler, which is run by 'make test'.
+ * A source is assembled in memory and its words and symbols are compared with the expected ones, a source with
+ * errors is checked for its diagnostics, and the first source is assembled on several threads at once. */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "library.h"
+
+
+#define TEST_THREADS 4
+#define THREAD_RUNS 200
+#define ARRAY_LENGTH(array) (sizeof(array) / sizeof((array)[0]))
+
+enum {
+    FALSE, TRUE
+};
+
+
+/* A source with an entry, an external, a relocatable word and data */
+static const char source[] = ".entry MAIN\n.extern OUT\nMAIN:\tmov NUMS, @r1\n\tjmp OUT\n\tstop\nNUMS:\t.data 5, -5\n";
+
+static const uint16_t expected_code[] = {0x614, 0x1AA, 0x004, 0x12C, 0x001, 0x1E0};
+
+static const uint16_t expected_data[] = {0x005, 0xFFB};
+
+/* A source with an invalid statement in line 1 and invalid data in line 3 */
+static const char errors_source[] = "MAIN:\tmov @r1\n\tstop\nX:\t.data a\n";
+
+
+static int check_result(resptr result, const char *name);
+
+static int check_errors(void);
+
+static void *assemble_thread(void *arg);
+
+static int failure(const char *name, const char *problem);
+
+
+int main(void) {
+    AssemblyResult result;
+    Options options;
+    pthread_t threads[TEST_THREADS];
+    int failed[TEST_THREADS], started[TEST_THREADS], passed = TRUE, i;
+
+    default_options(&options);
+    if (assemble_buffer(source, strlen(source), &options, &result) != 1)
+        passed = failure("source", "wasn't assembled");
+    else
+        passed = check_result(&result, "source");
+    free_result(&result);
+
+    passed = check_errors() && passed;
+
+    for (i = 0; i < TEST_THREADS; i++) {
+        failed[i] = FALSE;
+        started[i] = !pthread_create(&threads[i], NULL, assemble_thread, &failed[i]);
+    }
+    for (i = 0; i < TEST_THREADS; i++) {
+        if (!started[i])
+            passed = failure("threads", "a thread wasn't started");
+        else if (pthread_join(threads[i], NULL) || failed[i])
+            passed = failure("threads", "a thread got different outputs");
+    }
+
+    return passed ? 0 : 1;
+}
+
+
+/* Compares the outputs of the source with the expected ones. Returns 1 if they are the same, else returns 0 */
+static int check_result(resptr result, const char *name) {
+    if (result->diagnostics_count)
+        return failure(name, "has errors");
+    if (result->address != DEFAULT_ADDRESS)
+        return failure(name, "has a different address");
+    if (result->code_length != ARRAY_LENGTH(expected_code) ||
+        memcmp(result->code, expected_code, sizeof(expected_code)))
+        return failure(name, "has different code words");
+    if (result->data_length != ARRAY_LENGTH(expected_data) ||
+        memcmp(result->data, expected_data, sizeof(expected_data)))
+        return failure(name, "has different data words");
+    if (result->entries_count != 1 || strcmp(result->entries[0].name, "MAIN") || result->entries[0].address != 100)
+        return failure(name, "has different entries");
+    if (result->externals_count != 1 || strcmp(result->externals[0].name, "OUT") ||
+        result->externals[0].address != 104)
+        return failure(name, "has different externals");
+
+    return TRUE;
+}
+
+
+/* Assembles the source with errors, and checks its diagnostics. Returns 1 if they are the expected ones */
+static int check_errors(void) {
+    AssemblyResult result;
+    Options options;
+    int passed = TRUE;
+
+    default_options(&options);
+    if (assemble_buffer(errors_source, strlen(errors_source), &options, &result) != 0)
+        passed = failure("errors source", "wasn't rejected");
+    else if (result.diagnostics_count != 2 ||
+             result.diagnostics[0].line != 1 || result.diagnostics[0].code != INVALID_STATEMENT ||
+             result.diagnostics[1].line != 3 || result.diagnostics[1].code != INVALID_DATA)
+        passed = failure("errors source", "has different errors");
+    free_result(&result);
+
+    return passed;
+}
+
+
+/* Assembles the source again and again, on a thread of its own. Sets the flag of the thread if an output differs */
+static void *assemble_thread(void *arg) {
+    AssemblyResult result;
+    Options options;
+    int i;
+
+    default_options(&options);
+    for (i = 0; i < THREAD_RUNS; i++) {
+        if (assemble_buffer(source, strlen(source), &options, &result) != 1 || !check_result(&result, "thread"))
+            *(int *) arg = TRUE;
+        free_result(&result);
+    }
+
+    return NULL;
+}
+
+
+/* Prints a failed check. Returns 0 */
+static int failure(const char *name, const char *problem) {
+    printf("FAILED: library %s %s\n", name, problem);
+    return FALSE;
+}
@@ -0,0 +1,9 @@
+; The main module of a link - uses the entries of link1b, and a label of its own data
+.entry MAIN
+.extern PRINT
+.extern COUNT
+MAIN:	mov COUNT, @r2
+	jsr PRINT
+	lea MSG, @r1
+	stop
+MSG:	.data 72, -1
@@ -0,0 +1,8 @@
+; The second module of a link - its code and its data are moved after those of link1a
+.entry PRINT
+.entry COUNT
+PRINT:	prn @r2
+	bne DONE
+	prn COUNT
+DONE:	rts
+COUNT:	.data 3
@@ -0,0 +1,196 @@
+#!/bin/sh
+# Assembles the samples of this directory and compares them with their expected outputs.
+# usage: run_tests.sh assembler [generate]
+# The other programs are taken from the directory of the assembler.
+#   succN.as - must be assembled. If succN.ob exists, the .ob, .ent, .ext and .bo files must be the same as the
+#              expected ones, and a missing expected file must not be created.
+#   failN.as - must fail. If failN.err exists, the error lines must be the same as the expected ones.
+# A sample whose first line is '; args: ...' is assembled with these options.
+# The outputs of '-o' must stay under its directory, even for a source given by a path with '..'.
+# A file restored from '--cache' must print the warnings of the run which stored it.
+# With '-j' a file which can't be opened must be reported in order with the messages of the other files.
+# The linker must join link1a and link1b into the image of link1.ob and link1.ent.
+# The emulator must print emul1.out for emul1, copy its input with emul2, and stop emul3 at '--limit' with code 2.
+# The disassembler must print disasm1.dis for disasm1, and its source must assemble back into the same files.
+# The server must answer the requests of server1.in on the standard input with server1.out, up to 'SHUTDOWN'.
+# library_test, which is built from library_test.c, must pass its checks of the library.
+# With the generator, large sources assembled in chunks by '--threads' must have the outputs and the messages of the
+# serial passes - also those which fall back to them: a source with errors, a label defined twice and an external
+# which is an entry.
+
+ASSEMBLER=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+TOOLS=$(dirname "$ASSEMBLER")
+[ -n "$2" ] && GENERATE=$(cd "$(dirname "$2")" && pwd)/$(basename "$2")
+SAMPLES=$(cd "$(dirname "$0")" && pwd)
+WORK=$(mktemp -d)
+FAILED=0
+
+trap 'rm -rf "$WORK"' EXIT
+
+fail() {
+    echo "FAILED: $1"
+    FAILED=$((FAILED + 1))
+}
+
+# Prints the options of a sample
+sample_args() {
+    sed -n '1s/^; args: //p' "$1"
+}
+
+# Assembles a source of the current directory serially and in chunks, and compares their outputs and messages
+compare_threads() {
+    mkdir "serial-$1" "threads-$1"
+    cp "$1.as" "serial-$1"
+    cp "$1.as" "threads-$1"
+    (cd "serial-$1" && "$ASSEMBLER" "$1" > "$1.out" 2>&1)
+    (cd "threads-$1" && "$ASSEMBLER" --threads 4 "$1" > "$1.out" 2>&1)
+    for extension in out ob ent ext; do
+        if [ -f "serial-$1/$1.$extension" ] || [ -f "threads-$1/$1.$extension" ]; then
+            cmp -s "serial-$1/$1.$extension" "threads-$1/$1.$extension" || fail "$1.$extension is different in chunks"
+        fi
+    done
+}
+
+cp "$SAMPLES"/*.as "$WORK"
+cd "$WORK" || exit 1
+
+for source in succ*.as; do
+    name=${source%.as}
+    if ! "$ASSEMBLER" $(sample_args "$source") "$name" > "$name.out" 2>&1; then
+        fail "$name wasn't assembled"
+        continue
+    fi
+    [ -f "$SAMPLES/$name.ob" ] || continue
+    for extension in ob ent ext bo; do
+        if [ -f "$SAMPLES/$name.$extension" ]; then
+            cmp -s "$SAMPLES/$name.$extension" "$name.$extension" || fail "$name.$extension is different"
+        elif [ -f "$name.$extension" ]; then
+            fail "$name.$extension was created"
+        fi
+    done
+done
+
+for source in fail*.as; do
+    name=${source%.as}
+    if "$ASSEMBLER" $(sample_args "$source") "$name" > "$name.out" 2>&1; then
+        fail "$name was assembled"
+    elif [ -f "$SAMPLES/$name.err" ]; then
+        grep "ERROR" "$name.out" | cmp -s "$SAMPLES/$name.err" - || fail "$name has different errors"
+    fi
+done
+
+mkdir -p paths/sub
+cp succ1.as paths
+if ! (cd paths/sub && "$ASSEMBLER" -o ../out ../succ1 > /dev/null 2>&1); then
+    fail "-o wasn't assembled"
+elif [ ! -f paths/out/succ1.ob ]; then
+    fail "-o didn't create out/succ1.ob"
+elif [ -n "$(find paths -name 'succ1.ob' ! -path 'paths/out/*')" ]; then
+    fail "-o created succ1.ob out of its directory"
+fi
+
+mkdir ordered
+cp succ1.as succ2.as ordered
+(cd ordered && "$ASSEMBLER" -j 3 succ1 missing succ2 > ordered.out 2>/dev/null)
+if [ "$(grep -e "Assembling" -e "failed to open" ordered/ordered.out | tr -d ' ')" != \
+     "$(printf "Assembling:'succ1.as'\n***ERROR:failedtoopen'missing.as'***\nAssembling:'succ2.as'")" ]; then
+    fail "-j printed the messages out of order"
+fi
+
+mkdir cached
+cp succ9.as cached
+(cd cached && "$ASSEMBLER" --cache cache succ9 > miss.out 2>&1 && "$ASSEMBLER" --cache cache succ9 > hit.out 2>&1)
+if ! grep -q "Cache hit" cached/hit.out; then
+    fail "succ9 wasn't restored from the cache"
+elif ! grep -q "WARNING" cached/miss.out ||
+     [ "$(grep "WARNING" cached/miss.out)" != "$(grep "WARNING" cached/hit.out)" ]; then
+    fail "succ9 has different warnings on a cache hit"
+fi
+
+mkdir linked
+cp link1a.as link1b.as linked
+if ! (cd linked && "$ASSEMBLER" link1a link1b > /dev/null && "$TOOLS/linker" -o link1 link1a link1b > /dev/null); then
+    fail "link1 wasn't linked"
+else
+    for extension in ob ent; do
+        cmp -s "$SAMPLES/link1.$extension" "linked/link1.$extension" || fail "link1.$extension is different"
+    done
+fi
+
+mkdir emulated
+cp emul1.as emul2.as emul3.as emulated
+cd emulated || exit 1
+if ! "$ASSEMBLER" emul1 emul2 emul3 > /dev/null; then
+    fail "the emulator samples weren't assembled"
+else
+    "$TOOLS/emulator" emul1 > emul1.out 2>&1
+    status=$?
+    [ "$status" -eq 0 ] || fail "emul1 exited with $status"
+    cmp -s "$SAMPLES/emul1.out" emul1.out || fail "emul1 printed a different output"
+
+    printf 'copied\n' | "$TOOLS/emulator" emul2 > emul2.out 2>&1
+    status=$?
+    [ "$status" -eq 0 ] || fail "emul2 exited with $status"
+    [ "$(cat emul2.out)" = "copied" ] || fail "emul2 didn't copy its input"
+
+    "$TOOLS/emulator" --limit 1000 emul3 > emul3.out 2> emul3.err
+    status=$?
+    [ "$status" -eq 2 ] || fail "emul3 exited with $status instead of stopping at the limit"
+    [ -s emul3.out ] && fail "emul3 printed an output"
+fi
+cd ..
+
+mkdir disassembled
+cp disasm1.as disassembled
+cd disassembled || exit 1
+if ! "$ASSEMBLER" disasm1 > /dev/null; then
+    fail "disasm1 wasn't assembled"
+elif ! "$TOOLS/disassembler" disasm1 > disasm1.dis; then
+    fail "disasm1 wasn't disassembled"
+else
+    cmp -s "$SAMPLES/disasm1.dis" disasm1.dis || fail "disasm1.dis is different"
+    # the addresses are removed, and the directives are restored from the entries and the externals
+    {
+        cut -d' ' -f1 disasm1.ext | sort -u | sed 's/^/.extern /'
+        cut -d' ' -f1 disasm1.ent | sed 's/^/.entry /'
+        cut -f2- disasm1.dis
+    } > again.as
+    if ! "$ASSEMBLER" again > /dev/null; then
+        fail "the source of disasm1 wasn't assembled"
+    else
+        for extension in ob ent ext; do
+            cmp -s "disasm1.$extension" "again.$extension" || fail "the source of disasm1 has a different .$extension"
+        done
+    fi
+fi
+cd ..
+
+"$ASSEMBLER" --server - < "$SAMPLES/server1.in" > server1.out 2>&1
+status=$?
+[ "$status" -eq 0 ] || fail "the server exited with $status"
+cmp -s "$SAMPLES/server1.out" server1.out || fail "the server gave different responses"
+
+if [ ! -x "$TOOLS/library_test" ]; then
+    fail "library_test wasn't built"
+elif ! "$TOOLS/library_test"; then
+    fail "library_test"
+fi
+
+if [ -n "$GENERATE" ]; then
+    "$GENERATE" 20000 --seed 1 > large.as
+    "$GENERATE" 20000 --seed 2 --errors 1 > errors.as
+    { cat large.as; printf 'L0:\tstop\n'; } > duplicate.as
+    { printf '.entry X0\n'; cat large.as; } > entry.as
+    if [ "$(wc -c < large.as)" -lt 131072 ]; then
+        fail "large.as is too small for two chunks"
+    fi
+    for name in large errors duplicate entry; do
+        compare_threads "$name"
+    done
+fi
+
+if [ "$FAILED" -ne 0 ]; then
+    echo "$FAILED tests failed."
+    exit 1
+fi
+echo "All tests passed."
@@ -0,0 +1,11 @@
+; args: --binary
+; The binary object holds the words, the entries, the uses of externals and the relocatable words
+.entry MAIN
+.entry NUMS
+.extern OUT
+MAIN:	mov NUMS, @r1
+	add -3, @r1
+	jsr OUT
+	bne MAIN
+	stop
+NUMS:	.data 7, -7
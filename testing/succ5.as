@@ -0,0 +1,7 @@
+; Negative even numbers are stored in two's complement
+MAIN:	prn -6
+	prn -2
+	cmp -4, @r1
+	add -512, @r2
+	stop
+NUMS:	.data -2, -4, -6, -2046
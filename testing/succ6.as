@@ -0,0 +1,10 @@
+; Every word which uses an external is listed in the .ext file at its own address
+.extern IN
+.extern OUT
+MAIN:	mov IN, OUT
+	mov @r1, OUT
+	mov IN, @r2
+	add IN, IN
+	jmp OUT
+	stop
+.entry MAIN
@@ -0,0 +1,4 @@
+; Data below -2048 or above 2047 is clamped to the 12 bit range
+MAIN:	stop
+LOW:	.data -2047, -2048, -2049, -99999
+HIGH:	.data 2047, 2048, 99999
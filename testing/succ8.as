@@ -0,0 +1,10 @@
+; A macro is replaced by its body wherever it's used after its definition
+mcro swap
+	mov @r1, @r3
+	mov @r2, @r1
+	mov @r3, @r2
+endmcro
+	swap
+	prn @r1
+	swap
+	stop
@@ -0,0 +1,4 @@
+; A label on an external is a warning, which is printed again when the file is restored from the cache
+X:	.extern W
+MAIN:	jmp W
+	stop